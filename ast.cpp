@@ -3,257 +3,389 @@
 /*** Nodes
 */
 
-string DecASTNode::get_text() const {
-  return to_string(val);
+string AST::get_text(NodeId i) const {
+  switch(this->kind(i)){
+  case NODE_DEC: return to_string(this->value(i));
+  case NODE_ID: return m_symbols->name(this->symbol(i));
+  case NODE_BIN: case NODE_UN: return operator_text(this->op(i));
+  case NODE_TYPE: return this->value(i) ? "void" : "int";
+  case NODE_VAR: return this->get_text(this->child(i, 0));
+  case NODE_ARGS: return "arglist";
+  case NODE_PARAMS: return "paramlist";
+  case NODE_PROG: return "program";
+  case NODE_CALL: return "funccall";
+  case NODE_ASSIGN: return "assign";
+  case NODE_DECVAR: return "decvar";
+  case NODE_BLOCK: return "block";
+  case NODE_DECFUNC: return "decfunc";
+  case NODE_RETURN: return "return";
+  case NODE_BREAK: return "break";
+  case NODE_CONTINUE: return "continue";
+  case NODE_WHILE: return "while";
+  case NODE_IF: return "if";
+  }
+  throw runtime_error("invalid node kind");
 }
 
-void DecASTNode::check_and_generate(Code & code, ScopeStack & sta){
-  code.emitf("li $a0, %d", val);
-}
+// variables print as their name alone. the nodes to print go on an
+// explicit stack, NO_NODE closing the innermost one, so deep
+// expressions do not overflow the call stack.
+void AST::print_node(NodeId root) const {
+  std::vector<NodeId> stack(1, root);
+  while(!stack.empty()){
+    NodeId i = stack.back();
+    stack.pop_back();
+    if(i == NO_NODE){
+      cout << "]";
+      continue;
+    }
+
+    if(i != root)
+      cout << " ";
+    cout << "[" << this->get_text(i);
 
-void IdASTNode::check_and_generate(Code & code, ScopeStack & sta){
-  ScopeInt & var = sta.get_int(get_text());
-  if(var.is_global()){
-    code.load_globals();
-    code.emitf("lw $a0, %d($t0)", var.offset());
-  } else {
-    code.emitf("lw $a0, %d($sp)", var.offset() + code.get_machine_offset());
+    stack.push_back(NO_NODE);
+    if(this->kind(i) != NODE_VAR){
+      for(int k = this->children(i) - 1; k >= 0; k--)
+        stack.push_back(this->child(i, k));
+    }
   }
 }
 
-void BinASTNode::check_and_generate(Code & code, ScopeStack & sta){
-  check_and_generate_expression(left, code, sta);
-  code.emit_machine_push("a0");
-  check_and_generate_expression(right, code, sta);
-  code.emit_machine_top("t0");
-  code.emit_binary_operation("a0", "t0", "a0", get_text());
-  code.emit_machine_pop();
+// declarations and parameters, through nested blocks but not into
+// expressions or other functions
+int AST::count_declarations(NodeId root) const {
+  int res = 0;
+  std::vector<NodeId> stack(1, root);
+  while(!stack.empty()){
+    NodeId i = stack.back();
+    stack.pop_back();
+
+    switch(this->kind(i)){
+    case NODE_DECVAR:
+      res++;
+      break;
+    case NODE_PARAMS:
+      res += this->children(i);
+      break;
+    case NODE_DECFUNC:
+      stack.push_back(this->child(i, 2));
+      break;
+    case NODE_PROG: case NODE_BLOCK: case NODE_WHILE: case NODE_IF:
+      for(int k = 0; k < this->children(i); k++)
+        stack.push_back(this->child(i, k));
+      break;
+    default:
+      break;
+    }
+  }
+  return res;
 }
 
-void UnASTNode::check_and_generate(Code & code, ScopeStack & sta){
-  check_and_generate_expression(child, code, sta);
-  code.emit_unary_operation("a0", get_text());
-}
+/**
+ * Code generation
+ * */
+struct CodeGenerator : public ASTVisitor<CodeGenerator>{
+  Code & code;
+  ScopeStack & sta;
 
-void ArgsASTNode::check_and_generate(Code & code, ScopeStack & sta){
-  for(int i = (int)child.size()-1; i >= 0; i--){
-    auto p = child[i];
-    check_and_generate_expression(p, code, sta);
-    code.emit_machine_push("a0");
+  CodeGenerator(const AST & ast, Code & code, ScopeStack & sta)
+    : ASTVisitor(ast), code(code), sta(sta){}
+
+  // into another piece of code
+  void generate(NodeId i, Code & into){
+    CodeGenerator(ast, into, sta).dispatch(i);
   }
-}
 
-void ParamsASTNode::check_and_generate(Code & code, ScopeStack & sta){
-  for(unsigned i = 0; i < child.size(); i++){
-    auto p = child[i];
-    shared_ptr<VarASTNode> var = dynamic_pointer_cast<VarASTNode>(p);
-    if(var->is_void())
-      throw runtime_error("function argument cannot be void");
-    sta.declare_int(var->get_text()) = code.next();
+  // operators are evaluated in post-order over an explicit stack, so
+  // chains of any depth stay off the call stack; only calls recurse,
+  // through their arguments
+  void expression(NodeId root){
+    struct Pending{
+      NodeId id;
+      int operands; // evaluated so far
+    };
+    std::vector<Pending> stack(1, Pending{root, 0});
+
+    while(!stack.empty()){
+      NodeId expr = stack.back().id;
+      NodeKind kind = ast.kind(expr);
+
+      if(kind != NODE_BIN && kind != NODE_UN){
+        stack.pop_back();
+        this->term(expr);
+        continue;
+      }
+
+      int done = stack.back().operands++;
+      if(kind == NODE_UN && done == 1){
+        stack.pop_back();
+        code.emit_unary_operation("a0", ast.op(expr));
+      } else if(done == 2){
+        stack.pop_back();
+        code.emit_machine_top("t0");
+        code.emit_binary_operation("a0", "t0", "a0", ast.op(expr));
+        code.emit_machine_pop();
+      } else {
+        if(done == 1)
+          code.emit_machine_push("a0");
+        stack.push_back(Pending{ast.child(expr, done), 0});
+      }
+    }
   }
-}
 
-void CallASTNode::check_and_generate(Code & code, ScopeStack & sta){
-  ScopeFunc & func = sta.get_func(get_func_name());
-  if(!func.compatible_with(this->args->size()))
-    throw runtime_error("wrong number of arguments in function call");
-
-  code.emit_machine_save();
-  int old_machine_offset = code.get_machine_offset();
-  args->check_and_generate(code, sta);
-  code.set_machine_as_top();
-  code.emit_grow(func.count_declarations());
-  code.emitf("jal %s", code.get_label(get_func_name()).c_str());
-  code.emit_shrink(func.count_declarations() + args->size());
-  code.set_machine_offset(old_machine_offset);
-  code.emit_machine_recover();
-}
+  void term(NodeId expr){
+    if(ast.kind(expr) == NODE_CALL){
+      if(sta.get_func(ast.symbol(ast.child(expr, 0))).returns_void())
+        throw runtime_error("expression cannot have void terms");
+    }
 
-void AssignASTNode::check_and_generate(Code & code, ScopeStack & sta){
-  ScopeInt & var = sta.get_int(id->get_text());
-  int old_off = code.get_machine_offset();
-  check_and_generate_expression(expr, code, sta);
-  assert(code.get_machine_offset() == old_off);
+    if(ast.kind(expr) == NODE_ID){
+      sta.get_int(ast.symbol(expr));
+    }
 
-  if(var.is_global()){
-    code.load_globals();
-    code.emitf("sw $a0, %d($t0)", var.offset());
+    this->dispatch(expr);
   }
-  else
-    code.emitf("sw $a0, %d($sp)", var.offset());
-}
 
-void DecvarASTNode::check_and_generate(Code & code, ScopeStack & sta){
-  if(var->is_void())
-    throw runtime_error("variables cannot be declared void");
+  // types and variables only appear inside declarations
+  void visit(Node<NODE_TYPE>){}
+  void visit(Node<NODE_VAR>){}
 
+  void visit(Node<NODE_DEC> n){
+    code.emitf("li $a0, %d", ast.value(n.id));
+  }
 
-  if(!expr){
-    int off = sta.declare_int(var->get_text(), sta.is_global()) = code.next();
-    if(sta.is_global()){
-      code.load_globals();
-      code.emitf("sw $0, %d($t0)", off);
-    }else
-      code.emitf("sw $0, %d($sp)", off);
-  } else{
-    check_and_generate_expression(expr, code, sta);
-    int off = sta.declare_int(var->get_text(), sta.is_global()) = code.next();
-    if(sta.is_global()){
+  void visit(Node<NODE_ID> n){
+    ScopeInt & var = sta.get_int(ast.symbol(n.id));
+    if(var.is_global()){
       code.load_globals();
-      code.emitf("sw $a0, %d($t0)", off);
-    } else
-      code.emitf("sw $a0, %d($sp)", off);
+      code.emitf("lw $a0, %d($t0)", var.offset());
+    } else {
+      code.emitf("lw $a0, %d($sp)", var.offset() + code.get_machine_offset());
+    }
   }
-}
 
+  // see expression()
+  void visit(Node<NODE_BIN> n){
+    this->expression(n.id);
+  }
 
-void ProgASTNode::check_and_generate(Code & code, ScopeStack & sta){
-  code.emit_segment();
-  int decl = 0;
-  for(auto p : child)
-    if(dynamic_pointer_cast<DecvarASTNode>(p))
-      decl++;
+  void visit(Node<NODE_UN> n){
+    this->expression(n.id);
+  }
 
-  code.emit_globals(decl+1);
-  code.emit_header();
+  void visit(Node<NODE_ARGS> n){
+    for(int i = ast.children(n.id)-1; i >= 0; i--){
+      this->expression(ast.child(n.id, i));
+      code.emit_machine_push("a0");
+    }
+  }
 
-  sta.push();
-  sta.declare_func("print", false, 1, 0);
-  code.emit_print_code();
+  void visit(Node<NODE_PARAMS> n){
+    for(int i = 0; i < ast.children(n.id); i++){
+      NodeId var = ast.child(n.id, i);
+      if(ast.var_is_void(var))
+        throw runtime_error("function argument cannot be void");
+      sta.declare_int(ast.var_symbol(var)) = code.next();
+    }
+  }
 
-  Code glob_code;
-  glob_code.emit_entry_point();
+  void visit(Node<NODE_CALL> n){
+    NodeId id = ast.child(n.id, 0), args = ast.child(n.id, 1);
+    ScopeFunc & func = sta.get_func(ast.symbol(id));
+    if(!func.compatible_with(ast.children(args)))
+      throw runtime_error("wrong number of arguments in function call");
+
+    code.emit_machine_save();
+    int old_machine_offset = code.get_machine_offset();
+    this->dispatch(args);
+    code.set_machine_as_top();
+    code.emit_grow(func.count_declarations());
+    code.emitf("jal %s", code.get_label(ast.get_text(id)).c_str());
+    code.emit_shrink(func.count_declarations() + ast.children(args));
+    code.set_machine_offset(old_machine_offset);
+    code.emit_machine_recover();
+  }
+
+  void visit(Node<NODE_ASSIGN> n){
+    ScopeInt & var = sta.get_int(ast.symbol(ast.child(n.id, 0)));
+    int old_off = code.get_machine_offset();
+    this->expression(ast.child(n.id, 1));
+    assert(code.get_machine_offset() == old_off);
 
-  for(auto p : child)
-    if(dynamic_pointer_cast<DecvarASTNode>(p))
-      p->check_and_generate(glob_code, sta);
+    if(var.is_global()){
+      code.load_globals();
+      code.emitf("sw $a0, %d($t0)", var.offset());
+    }
     else
-      p->check_and_generate(code, sta);
+      code.emitf("sw $a0, %d($sp)", var.offset());
+  }
 
-  ScopeFunc & func = sta.get_func("main");
-  if(!func.compatible_with(0))
-    throw runtime_error("main should have no parameters");
+  void visit(Node<NODE_DECVAR> n){
+    NodeId var = ast.child(n.id, 0), expr = ast.child(n.id, 1);
+    if(ast.var_is_void(var))
+      throw runtime_error("variables cannot be declared void");
+
+    if(expr == NO_NODE){
+      int off = sta.declare_int(ast.var_symbol(var), sta.is_global()) = code.next();
+      if(sta.is_global()){
+        code.load_globals();
+        code.emitf("sw $0, %d($t0)", off);
+      }else
+        code.emitf("sw $0, %d($sp)", off);
+    } else{
+      this->expression(expr);
+      int off = sta.declare_int(ast.var_symbol(var), sta.is_global()) = code.next();
+      if(sta.is_global()){
+        code.load_globals();
+        code.emitf("sw $a0, %d($t0)", off);
+      } else
+        code.emitf("sw $a0, %d($sp)", off);
+    }
+  }
 
-  glob_code.emit_grow(func.count_declarations());
-  glob_code.emitf("jal %s", glob_code.get_label("main").c_str());
-  glob_code.emit_shrink(func.count_declarations());
-  glob_code.emit_exit();
+  void visit(Node<NODE_PROG> n){
+    code.emit_segment();
+    int decl = 0;
+    for(int i = 0; i < ast.children(n.id); i++)
+      if(ast.kind(ast.child(n.id, i)) == NODE_DECVAR)
+        decl++;
+
+    code.emit_globals(decl+1);
+    code.emit_header();
+
+    sta.push();
+    sta.declare_func(sta.symbol("print"), false, 1, 0);
+    code.emit_print_code();
+
+    Code glob_code;
+    glob_code.emit_entry_point();
+
+    for(int i = 0; i < ast.children(n.id); i++){
+      NodeId p = ast.child(n.id, i);
+      if(ast.kind(p) == NODE_DECVAR)
+        this->generate(p, glob_code);
+      else
+        this->dispatch(p);
+    }
 
-  code += glob_code;
-}
+    ScopeFunc & func = sta.get_func(sta.symbol("main"));
+    if(!func.compatible_with(0))
+      throw runtime_error("main should have no parameters");
 
-void DecfuncASTNode::check_and_generate(Code & code, ScopeStack & sta){
-  sta.declare_func(this->var->get_text(), this->var->is_int(),
-    this->params->size(), count_declarations());
+    glob_code.emit_grow(func.count_declarations());
+    glob_code.emitf("jal %s", glob_code.get_label("main").c_str());
+    glob_code.emit_shrink(func.count_declarations());
+    glob_code.emit_exit();
 
-  // emit function label
-  Code code_func;
-  code_func.emitf("nop # %s (%d declarations)", this->var->get_text().c_str(),
-                  count_declarations());
-  code_func.emit_label(this->var->get_text());
+    code += glob_code;
+  }
 
-  if(this->var->is_int())
-    sta.push_int();
-  else
-    sta.push_void();
+  void visit(Node<NODE_BLOCK> n){
+    for(int i = 0; i < ast.children(n.id); i++)
+      this->dispatch(ast.child(n.id, i));
+  }
 
-  code_func.set_offset(code.shift(count_declarations()));
-  params->check_and_generate(code_func, sta);
-  code_func.set_offset(0);
-  block->check_and_generate(code_func, sta);
+  void visit(Node<NODE_DECFUNC> n){
+    NodeId var = ast.child(n.id, 0);
+    NodeId params = ast.child(n.id, 1), block = ast.child(n.id, 2);
+    int decls = ast.count_declarations(n.id);
+    bool is_int = !ast.var_is_void(var);
 
-  sta.pop();
+    sta.declare_func(ast.var_symbol(var), is_int, ast.children(params), decls);
 
-  code_func.emit("jr $ra # should not reach here");
-  code += code_func;
-}
+    // emit function label
+    Code code_func;
+    string name = ast.get_text(var);
+    code_func.emitf("nop # %s (%d declarations)", name.c_str(), decls);
+    code_func.emit_label(name);
 
-void ReturnASTNode::check_and_generate(Code & code, ScopeStack & sta){
-  if(this->expr){
-    if(!sta.is_int())
-      throw runtime_error("return [expr] should be used inside def [int] function");
-    else {
-      check_and_generate_expression(expr, code, sta);
-    }
-  } else if(!this->expr && sta.is_int())
-    throw runtime_error("returning void value in a function of int return");
+    if(is_int)
+      sta.push_int();
+    else
+      sta.push_void();
 
-  code.emitf("jr $ra");
-}
+    code_func.set_offset(code.shift(decls));
+    this->generate(params, code_func);
+    code_func.set_offset(0);
+    this->generate(block, code_func);
 
-void BreakASTNode::check_and_generate(Code & code, ScopeStack & sta){
-  if(!sta.is_loop())
-    throw runtime_error("break should be used inside a loop");
-  LoopASTNode * no = (LoopASTNode*) sta.last_loop();
-  int idx = no->get_index();
-  auto label = code.get_loop_label(idx);
-  code.emitf("j %s", label.second.c_str());
-}
+    sta.pop();
 
-void ContinueASTNode::check_and_generate(Code & code, ScopeStack & sta){
-  if(!sta.is_loop())
-    throw runtime_error("continue should be used inside a loop");
-  LoopASTNode * no = (LoopASTNode*) sta.last_loop();
-  int idx = no->get_index();
-  auto label = code.get_loop_label(idx);
-  code.emitf("j %s", label.first.c_str());
-}
+    code_func.emit("jr $ra # should not reach here");
+    code += code_func;
+  }
+
+  void visit(Node<NODE_RETURN> n){
+    NodeId expr = ast.child(n.id, 0);
+    if(expr != NO_NODE){
+      if(!sta.is_int())
+        throw runtime_error("return [expr] should be used inside def [int] function");
+      else {
+        this->expression(expr);
+      }
+    } else if(sta.is_int())
+      throw runtime_error("returning void value in a function of int return");
+
+    code.emitf("jr $ra");
+  }
 
-void WhileASTNode::check_and_generate(Code & code, ScopeStack & sta){
-  idx = sta.push_loop(this);
+  void visit(Node<NODE_BREAK>){
+    if(!sta.is_loop())
+      throw runtime_error("break should be used inside a loop");
+    auto label = code.get_loop_label(sta.last_loop());
+    code.emitf("j %s", label.second.c_str());
+  }
 
-  // expr_code = Code(code.get_offset(), code.get_machine_offset());
-  auto label = code.get_loop_label(get_index());
-  code.emit_loop_begin(get_index());
+  void visit(Node<NODE_CONTINUE>){
+    if(!sta.is_loop())
+      throw runtime_error("continue should be used inside a loop");
+    auto label = code.get_loop_label(sta.last_loop());
+    code.emitf("j %s", label.first.c_str());
+  }
 
-  int old_off = code.get_machine_offset();
-  check_and_generate_expression(expr, code, sta);
-  code.emitf("beqz $a0, %s", label.second.c_str());
-  assert(code.get_machine_offset() == old_off);
-  // assert(code.get_offset() == expr_code.get_offset());
-  // assert(code.get_machine_offset() == expr_code.get_machine_offset());
+  void visit(Node<NODE_WHILE> n){
+    int idx = sta.push_loop();
 
-  block->check_and_generate(code, sta);
+    auto label = code.get_loop_label(idx);
+    code.emit_loop_begin(idx);
 
-  code.emitf("j %s", label.first.c_str());
-  code.emit_loop_end(get_index());
-  sta.pop();
-}
+    int old_off = code.get_machine_offset();
+    this->expression(ast.child(n.id, 0));
+    code.emitf("beqz $a0, %s", label.second.c_str());
+    assert(code.get_machine_offset() == old_off);
 
-void IfASTNode::check_and_generate(Code & code, ScopeStack & sta){
-  check_and_generate_expression(expr, code, sta);
-  int idx = sta.push_if();
-  auto label = code.get_if_label(idx);
+    this->dispatch(ast.child(n.id, 1));
 
-  code.emitf("beqz $a0, %s", label.first.c_str());
+    code.emitf("j %s", label.first.c_str());
+    code.emit_loop_end(idx);
+    sta.pop();
+  }
 
-  block->check_and_generate(code, sta);
-  code.emitf("j %s", label.second.c_str());
+  void visit(Node<NODE_IF> n){
+    this->expression(ast.child(n.id, 0));
+    int idx = sta.push_if();
+    auto label = code.get_if_label(idx);
 
-  code.emit_if_false(idx);
+    code.emitf("beqz $a0, %s", label.first.c_str());
+
+    this->dispatch(ast.child(n.id, 1));
+    code.emitf("j %s", label.second.c_str());
+
+    code.emit_if_false(idx);
 
-  sta.pop();
-  if(else_block){
-    sta.push_else();
-    else_block->check_and_generate(code, sta);
     sta.pop();
+    NodeId else_block = ast.child(n.id, 2);
+    if(else_block != NO_NODE){
+      sta.push_else();
+      this->dispatch(else_block);
+      sta.pop();
+    }
+
+    code.emit_if_end(idx);
   }
+};
 
-  code.emit_if_end(idx);
+void generate(const AST & ast, NodeId root, Code & code, ScopeStack & sta){
+  CodeGenerator(ast, code, sta).dispatch(root);
 }
-
-/**
- * Late Helpers
- * */
- void ASTNode::check_and_generate_expression(shared_ptr<ASTNode> expr, Code & code, ScopeStack & sta){
-   if(ASTNode::get_as<CallASTNode>(expr)){
-     if(sta.get_func(ASTNode::get_as<CallASTNode>(expr)->get_func_name()).returns_void())
-       throw runtime_error("expression cannot have void terms");
-   }
-
-   if(ASTNode::get_as<IdASTNode>(expr)){
-     sta.get_int(ASTNode::get_as<IdASTNode>(expr)->get_text());
-   }
-
-   expr->check_and_generate(code, sta);
- }
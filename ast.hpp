@@ -2,9 +2,10 @@
 
 #include "scope.hpp"
 #include "code.hpp"
+#include <cstdint>
+#include <initializer_list>
 #include <string>
 #include <iostream>
-#include <memory>
 #include <vector>
 
 using namespace std;
@@ -14,462 +15,154 @@ using namespace std;
  * Nodes and Helpers
  * */
 
-struct ASTNode{
-  string text;
-  int memo = -1;
-
-  ASTNode(){}
-  ASTNode(string s) : text(s){}
-
-  virtual string get_text() const {
-    return text;
-  }
-
-  virtual void print_node() const {
-    cout << "[" << this->get_text();
-    this->print_children();
-    cout << "]";
-  }
-
-  virtual void print_children() const {}
-
-  virtual void check_and_generate(Code &, ScopeStack &) {}
-  virtual int _count_declarations() { return 0; }
-  virtual int count_declarations() {
-    if(memo != -1) return memo;
-    return memo = _count_declarations();
-  }
-
-  template<typename T>
-  static shared_ptr<T> get_as(shared_ptr<ASTNode> st){
-    return dynamic_pointer_cast<T>(st);
-  }
-
-  static void check_and_generate_expression(shared_ptr<ASTNode>, Code & code, ScopeStack &);
-};
-
-struct DecASTNode : public ASTNode {
-  int val;
-
-  DecASTNode(string s) : val(atoi(s.c_str())){}
-  DecASTNode(int x) : val(x){}
-  DecASTNode(shared_ptr<ASTNode> st){
-    val = atoi(st->get_text().c_str());
-  }
-
-  string get_text() const;
-
-  void check_and_generate(Code & code, ScopeStack & sta);
-};
-
-struct IdASTNode : public ASTNode{
-  IdASTNode(string s){
-    text = s;
-  }
-
-  IdASTNode(shared_ptr<ASTNode> st){
-    text = st->get_text();
-  }
-
-  void check_and_generate(Code & code, ScopeStack & sta);
-};
-
-struct BinASTNode : public ASTNode{
-  shared_ptr<ASTNode> left, right;
-
-  BinASTNode(shared_ptr<ASTNode> left, shared_ptr<ASTNode> right, string text = "+"){
-    this->left = left;
-    this->right = right;
-    this->text = text;
-  }
-
-  BinASTNode(shared_ptr<ASTNode> left, shared_ptr<ASTNode> right,
-      shared_ptr<ASTNode> op){
-    this->left = left;
-    this->right = right;
-    this->text = op->get_text();
-  }
-
-  void print_children() const{
-    cout << " ";
-    left->print_node();
-    cout << " ";
-    right->print_node();
-  }
-
-  void check_and_generate(Code & code, ScopeStack & sta);
-};
-
-struct UnASTNode : public ASTNode{
-  shared_ptr<ASTNode> child;
-
-  UnASTNode(shared_ptr<ASTNode> child, string text){
-    this->child = child;
-    this->text = text;
-  }
-
-  UnASTNode(shared_ptr<ASTNode> child, shared_ptr<ASTNode> op){
-    this->child = child;
-    this->text = op->get_text();
-  }
-
-  void print_children() const {
-    cout << " ";
-    child->print_node();
-  }
-
-  void check_and_generate(Code & code, ScopeStack & sta);
-};
-
-struct TypeASTNode : public ASTNode{
-  shared_ptr<ASTNode> st;
-
-  TypeASTNode(shared_ptr<ASTNode> st){
-    this->st = st;
-  }
-
-  string get_text() const {
-    return this->st->get_text();
-  }
-  bool is_int() const { return this->get_text() == "int"; }
-  bool is_void() const { return this->get_text() == "void"; }
-};
-
-
-struct VarASTNode : public ASTNode {
-  shared_ptr<IdASTNode> id;
-  shared_ptr<TypeASTNode> type;
-
-  VarASTNode(shared_ptr<ASTNode> id, shared_ptr<ASTNode> type){
-    this->id = static_pointer_cast<IdASTNode>(id);
-    this->type = static_pointer_cast<TypeASTNode>(type);
-  }
-
-  string get_text() const {
-    return id->get_text();
-  }
-
-  bool is_int() const {
-    return type->is_int();
-  }
-
-  bool is_void() const {
-    return type->is_void();
-  }
-};
-
-struct ListASTNode : public ASTNode{
-  vector<shared_ptr<ASTNode>> child;
-
-  virtual void append(shared_ptr<ASTNode> nw){
-    child.push_back(nw);
-  }
-
-  int size() const { return child.size(); }
-  void print_children() const {
-    for(const auto & no : child){
-      cout << " ";
-      no->print_node();
-    }
-  }
-};
-
-struct ArgsASTNode : public ListASTNode{
-  string get_text() const {
-    return "arglist";
-  }
-  void check_and_generate(Code & code, ScopeStack & sta);
+enum NodeKind : unsigned char {
+  NODE_DEC, NODE_ID, NODE_BIN, NODE_UN, NODE_TYPE, NODE_VAR,
+  NODE_ARGS, NODE_PARAMS, NODE_PROG, NODE_CALL, NODE_ASSIGN,
+  NODE_DECVAR, NODE_BLOCK, NODE_DECFUNC, NODE_RETURN, NODE_BREAK,
+  NODE_CONTINUE, NODE_WHILE, NODE_IF
 };
 
-struct ParamsASTNode : public ListASTNode{
-  string get_text() const {
-    return "paramlist";
-  }
+typedef int32_t NodeId;
+const NodeId NO_NODE = -1;
 
-  int _count_declarations() override { return this->size(); }
+typedef std::pair<int, int> Location;
 
-  void check_and_generate(Code & code, ScopeStack & sta);
-
-};
-
-struct CallASTNode : public ASTNode{
-  shared_ptr<IdASTNode> id;
-  shared_ptr<ArgsASTNode> args;
-
-  CallASTNode(shared_ptr<ASTNode> id){
-    this->id = static_pointer_cast<IdASTNode>(id);
-    this->args = make_shared<ArgsASTNode>();
-  }
-
-  CallASTNode(shared_ptr<ASTNode> id, shared_ptr<ArgsASTNode> args){
-    this->id = static_pointer_cast<IdASTNode>(id);
-    this->args = args;
-  }
-
-  string get_text() const {
-    return "funccall";
-  }
-
-  string get_func_name() const {
-    return this->id->get_text();
-  }
-
-  void print_children() const {
-    cout << " ";
-    id->print_node();
-    cout << " ";
-    args->print_node();
-  }
-
-  void check_and_generate(Code & code, ScopeStack & sta);
-};
-
-struct AssignASTNode : public ASTNode{
-  shared_ptr<IdASTNode> id;
-  shared_ptr<ASTNode> expr;
-
-  AssignASTNode(shared_ptr<ASTNode> id, shared_ptr<ASTNode> expr){
-    this->id = static_pointer_cast<IdASTNode>(id);
-    this->expr = expr;
-  }
-
-  string get_text() const {
-    return "assign";
-  }
-
-  void print_children() const {
-    cout << " ";
-    id->print_node();
-    cout << " ";
-    expr->print_node();
-  }
-
-  void check_and_generate(Code & code, ScopeStack & sta);
-};
-
-struct DecvarASTNode : public ASTNode{
-  shared_ptr<VarASTNode> var;
-  shared_ptr<ASTNode> expr;
+/*
+ * The nodes of a program, as parallel arrays indexed by NodeId, all
+ * released with the AST. A node is a kind, a value, the location of its
+ * first token and a run of child ids in one shared array. The value and
+ * children of each kind are:
+ *
+ *   DEC      the literal
+ *   ID       symbol id
+ *   BIN      operator; left, right
+ *   UN       operator; operand
+ *   TYPE     1 if void
+ *   VAR      id, type
+ *   ARGS, PARAMS, PROG
+ *            the items
+ *   CALL     id, args
+ *   ASSIGN   id, expr
+ *   DECVAR   var[, expr]
+ *   BLOCK    number of declarations; the declarations, then statements
+ *   DECFUNC  var, params, block
+ *   RETURN   [expr]
+ *   WHILE    expr, block
+ *   IF       expr, block[, else block]
+ * */
+class AST{
+private:
+  const SymbolTable * m_symbols;
 
-  DecvarASTNode(shared_ptr<ASTNode> var, shared_ptr<ASTNode> expr = 0){
-    this->var = static_pointer_cast<VarASTNode>(var);
-    this->expr = expr;
-  }
+  std::vector<NodeKind> m_kind;
+  std::vector<int32_t> m_value;
+  // a node's children are appended along with it, so they run up to
+  // where the next node's start: m_children[m_first[i], m_first[i+1])
+  std::vector<int32_t> m_first;
+  std::vector<Location> m_loc;
+  std::vector<NodeId> m_children;
 
-  string get_text() const {
-    return "decvar";
-  }
+public:
+  AST(const SymbolTable & symbols) : m_symbols(&symbols) {}
 
-  void print_children() const {
-    cout << " ";
-    var->print_node();
-    if(expr){
-      cout << " ";
-      expr->print_node();
-    }
+  NodeId add(NodeKind kind, int32_t value, Location loc,
+             std::initializer_list<NodeId> children = {}){
+    return this->add(kind, value, loc, children.begin(), children.end());
   }
 
-  int _count_declarations() override { return 1; }
-
-  void check_and_generate(Code & code, ScopeStack & sta);
-};
-
-struct ProgASTNode : public ListASTNode{
-  void append(shared_ptr<ASTNode> st){
-    //child.insert(child.begin(), st);
-    child.push_back(st);
+  NodeId add(NodeKind kind, int32_t value, Location loc,
+             const std::vector<NodeId> & children){
+    return this->add(kind, value, loc, children.data(),
+                     children.data() + children.size());
   }
 
-  string get_text() const {
-    return "program";
+  NodeId add(NodeKind kind, int32_t value, Location loc,
+             const NodeId * begin, const NodeId * end){
+    m_kind.push_back(kind);
+    m_value.push_back(value);
+    m_first.push_back(m_children.size());
+    m_loc.push_back(loc);
+    m_children.insert(m_children.end(), begin, end);
+    return m_kind.size() - 1;
   }
 
-  int _count_declarations() override {
-    int res = 0;
-    for(auto p : child)
-      res += p->count_declarations();
-    return res;
+  int size() const { return m_kind.size(); }
+  size_t bytes() const {
+    return m_kind.capacity() * sizeof(NodeKind)
+      + (m_value.capacity() + m_first.capacity()) * sizeof(int32_t)
+      + m_loc.capacity() * sizeof(Location)
+      + m_children.capacity() * sizeof(NodeId);
   }
 
-  void check_and_generate(Code & code, ScopeStack & sta);
-};
-
-struct LoopASTNode : public ASTNode{
-  int idx = 0;
+  NodeKind kind(NodeId i) const { return m_kind[i]; }
+  int32_t value(NodeId i) const { return m_value[i]; }
+  Location location(NodeId i) const { return m_loc[i]; }
 
-  int get_index() const { return idx; }
-};
-
-struct BlockASTNode : public ASTNode{
-  vector<shared_ptr<ASTNode>> declarations, statements;
-
-  void append_declaration(shared_ptr<ASTNode> st){
-    declarations.push_back(st);
+  int children(NodeId i) const {
+    size_t end = i + 1 < this->size() ? m_first[i + 1] : m_children.size();
+    return end - m_first[i];
   }
-
-  void append_statement(shared_ptr<ASTNode> st){
-    statements.push_back(st);
+  // the k-th child, or NO_NODE past the last one
+  NodeId child(NodeId i, int k) const {
+    return k < this->children(i) ? m_children[m_first[i] + k] : NO_NODE;
   }
 
-  string get_text() const {
-    return "block";
-  }
+  Operator op(NodeId i) const { return (Operator)m_value[i]; }
+  int symbol(NodeId i) const { return m_value[i]; }
 
-  void print_children() const {
-    for(const auto & p : declarations){
-      cout << " ";
-      p->print_node();
-    }
-    for(const auto & p : statements){
-      cout << " ";
-      p->print_node();
-    }
-  }
+  // of a variable, through its id and type children
+  int var_symbol(NodeId var) const { return this->symbol(this->child(var, 0)); }
+  bool var_is_void(NodeId var) const { return this->value(this->child(var, 1)); }
 
-  int _count_declarations() override{
-    int res = declarations.size();
-    for(auto p : statements)
-      res += p->count_declarations();
-    return res;
-  }
+  string get_text(NodeId) const;
+  void print_node(NodeId) const;
 
-  void check_and_generate(Code & code, ScopeStack & sta){
-    for(auto p : declarations)
-      p->check_and_generate(code, sta);
-
-    for(auto p : statements)
-      p->check_and_generate(code, sta);
-  }
+  // stack slots a function needs for its locals and parameters
+  int count_declarations(NodeId) const;
 };
 
-struct DecfuncASTNode : public ASTNode {
-  shared_ptr<VarASTNode> var;
-  shared_ptr<ParamsASTNode> params;
-  shared_ptr<BlockASTNode> block;
-
-  DecfuncASTNode(shared_ptr<ASTNode> var, shared_ptr<ASTNode> params,
-      shared_ptr<ASTNode> block){
-    this->var = static_pointer_cast<VarASTNode>(var);
-    this->params = dynamic_pointer_cast<ParamsASTNode>(params);
-    this->block = static_pointer_cast<BlockASTNode>(block);
-  }
-
-  string get_text() const {
-    return "decfunc";
-  }
-
-  void print_children() const {
-    cout << " ";
-    var->print_node();
-    cout << " ";
-    params->print_node();
-    cout << " ";
-    block->print_node();
-  }
-
-  int _count_declarations() override{
-    return block->count_declarations();
-  }
-
-  void check_and_generate(Code & code, ScopeStack & sta);
-};
-
-
-struct ReturnASTNode : public ASTNode{
-  shared_ptr<ASTNode> expr;
-
-  ReturnASTNode(shared_ptr<ASTNode> expr = 0){
-    this->expr = expr;
-  }
-
-  string get_text() const{
-    return "return";
-  }
-
-  void print_children() const {
-    if(expr){
-      cout << " ";
-      expr->print_node();
+/*
+ * Static visitor: Derived provides visit(Node<K>) for the node kinds it
+ * handles (a template visit covers the rest), and dispatch() picks the
+ * overload from the node kind, without RTTI or virtual calls.
+ * */
+template<NodeKind K>
+struct Node{
+  NodeId id;
+};
+
+template<typename Derived, typename R = void>
+struct ASTVisitor{
+  const AST & ast;
+
+  ASTVisitor(const AST & ast) : ast(ast){}
+
+  R dispatch(NodeId id){
+    Derived & self = static_cast<Derived &>(*this);
+    switch(ast.kind(id)){
+    case NODE_DEC: return self.visit(Node<NODE_DEC>{id});
+    case NODE_ID: return self.visit(Node<NODE_ID>{id});
+    case NODE_BIN: return self.visit(Node<NODE_BIN>{id});
+    case NODE_UN: return self.visit(Node<NODE_UN>{id});
+    case NODE_TYPE: return self.visit(Node<NODE_TYPE>{id});
+    case NODE_VAR: return self.visit(Node<NODE_VAR>{id});
+    case NODE_ARGS: return self.visit(Node<NODE_ARGS>{id});
+    case NODE_PARAMS: return self.visit(Node<NODE_PARAMS>{id});
+    case NODE_PROG: return self.visit(Node<NODE_PROG>{id});
+    case NODE_CALL: return self.visit(Node<NODE_CALL>{id});
+    case NODE_ASSIGN: return self.visit(Node<NODE_ASSIGN>{id});
+    case NODE_DECVAR: return self.visit(Node<NODE_DECVAR>{id});
+    case NODE_BLOCK: return self.visit(Node<NODE_BLOCK>{id});
+    case NODE_DECFUNC: return self.visit(Node<NODE_DECFUNC>{id});
+    case NODE_RETURN: return self.visit(Node<NODE_RETURN>{id});
+    case NODE_BREAK: return self.visit(Node<NODE_BREAK>{id});
+    case NODE_CONTINUE: return self.visit(Node<NODE_CONTINUE>{id});
+    case NODE_WHILE: return self.visit(Node<NODE_WHILE>{id});
+    case NODE_IF: return self.visit(Node<NODE_IF>{id});
     }
+    throw runtime_error("invalid node kind");
   }
-
-  void check_and_generate(Code & code, ScopeStack & sta);
 };
 
-struct BreakASTNode : public ASTNode{
-  string get_text() const {
-    return "break";
-  }
-
-  void check_and_generate(Code & code, ScopeStack & sta);
-};
-
-struct ContinueASTNode : public ASTNode{
-  string get_text() const{
-    return "continue";
-  }
-
-  void check_and_generate(Code & code, ScopeStack & sta);
-};
-
-struct WhileASTNode : public LoopASTNode{
-  shared_ptr<ASTNode> expr;
-  shared_ptr<BlockASTNode> block;
-
-  WhileASTNode(shared_ptr<ASTNode> expr, shared_ptr<ASTNode> block){
-    this->expr = expr;
-    this->block = dynamic_pointer_cast<BlockASTNode>(block);
-  }
-
-  string get_text() const {
-    return "while";
-  }
-
-  int _count_declarations() override {
-    return block->count_declarations();
-  }
-
-  void print_children() const {
-    cout << " ";
-    expr->print_node();
-    cout << " ";
-    block->print_node();
-  }
-
-  void check_and_generate(Code & code, ScopeStack & sta);
-};
-
-
-struct IfASTNode : public ASTNode{
-  shared_ptr<ASTNode> expr;
-  shared_ptr<BlockASTNode> block, else_block;
-
-  IfASTNode(shared_ptr<ASTNode> expr, shared_ptr<ASTNode> block,
-      shared_ptr<ASTNode> else_block = 0){
-    this->expr = expr;
-    this->block = dynamic_pointer_cast<BlockASTNode>(block);
-    this->else_block = dynamic_pointer_cast<BlockASTNode>(else_block);
-  }
-
-  string get_text() const {
-    return "if";
-  }
-
-  void print_children() const {
-    cout << " ";
-    expr->print_node();
-    cout << " ";
-    block->print_node();
-    if(else_block){
-      cout << " ";
-      else_block->print_node();
-    }
-  }
-
-  int _count_declarations() override{
-    return block->count_declarations() +
-      (else_block ? else_block->count_declarations() : 0);
-  }
-
-  void check_and_generate(Code & code, ScopeStack & sta);
-};
+// semantic checks and code for the whole program rooted at root
+void generate(const AST &, NodeId root, Code & code, ScopeStack &);
@@ -0,0 +1,49 @@
+#include "def_lexer.hpp"
+#include "lexer/regex.hpp"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+
+using namespace std;
+
+/*
+ * Counts heap allocations made while building the Def lexer, with
+ * keywords as DFA rules so every rule goes through the regex pipeline.
+ */
+
+typedef chrono::steady_clock Clock;
+
+const int ROUNDS = 20;
+
+static size_t allocations = 0;
+
+void * operator new(size_t n){
+  allocations++;
+  if(void * p = malloc(n ? n : 1))
+    return p;
+  throw bad_alloc();
+}
+
+void operator delete(void * p) noexcept{
+  free(p);
+}
+
+void operator delete(void * p, size_t) noexcept{
+  free(p);
+}
+
+int main(){
+  size_t before = allocations;
+  auto start = Clock::now();
+  for(int i = 0; i < ROUNDS; i++){
+    Lexer lexer;
+    setup_def_lexer(lexer, true);
+    lexer.build();
+  }
+  double ms = chrono::duration<double, milli>(Clock::now() - start).count();
+
+  printf("def rules  %9zu allocations/setup %9.3f ms/setup\n",
+         (allocations - before) / ROUNDS, ms / ROUNDS);
+  return 0;
+}
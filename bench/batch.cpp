@@ -0,0 +1,79 @@
+#include "lexer/regex.hpp"
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+/*
+ * Matching throughput of a regex over many short lines, one line at a
+ * time versus DFA::run_batch with one and with several lanes.
+ */
+
+typedef chrono::steady_clock Clock;
+
+const int LINES = 1 << 20;
+const int ROUNDS = 5;
+
+struct Lines{
+  string data;
+  vector<size_t> begin, end;
+};
+
+Lines generate(){
+  Lines res;
+  unsigned seed = 7;
+  for(int i = 0; i < LINES; i++){
+    seed = seed * 1103515245u + 12345u;
+    int len = 8 + (seed >> 16) % 56;
+    res.begin.push_back(res.data.size());
+    for(int j = 0; j < len; j++){
+      seed = seed * 1103515245u + 12345u;
+      res.data += "abcdexyz_019"[(seed >> 16) % 12];
+    }
+    res.end.push_back(res.data.size());
+    res.data += '\n';
+  }
+  return res;
+}
+
+void report(const char * name, Clock::time_point since, int accepted){
+  double s = chrono::duration<double>(Clock::now() - since).count();
+  printf("%-16s %8.2f M lines/s  (%d accepted)\n", name,
+         (double)LINES * ROUNDS / s / 1e6, accepted / ROUNDS);
+}
+
+int main(){
+  Lines lines = generate();
+  Regex re("[a-z_]*(ab|cd|e[0-9]+)[a-z0-9_]*");
+  DFA dfa = re.get_dfa();
+  vector<char> results(LINES);
+
+  int accepted = 0;
+  auto start = Clock::now();
+  for(int r = 0; r < ROUNDS; r++){
+    for(int i = 0; i < LINES; i++){
+      string s(lines.data, lines.begin[i], lines.end[i] - lines.begin[i]);
+      accepted += dfa.run(s);
+    }
+  }
+  report("run per line", start, accepted);
+
+  for(int lanes : {1, DFA_BATCH_LANES}){
+    accepted = 0;
+    start = Clock::now();
+    for(int r = 0; r < ROUNDS; r++){
+      dfa.run_batch(lines.data.data(), lines.begin.data(), lines.end.data(),
+                    LINES, results.data(), lanes);
+      for(char x : results)
+        accepted += x;
+    }
+
+    char name[32];
+    snprintf(name, sizeof name, "batch, %d lane%s", lanes, lanes > 1 ? "s" : "");
+    report(name, start, accepted);
+  }
+
+  return 0;
+}
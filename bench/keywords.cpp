@@ -0,0 +1,119 @@
+#include "def_lexer.hpp"
+#include "lexer/lexer.hpp"
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <string>
+
+using namespace std;
+
+/*
+ * Compares the Def lexer with keywords as DFA rules against keywords
+ * looked up among identifiers, lexing a Def source (a generated one
+ * heavy on keywords and identifiers by default). Each is timed twice:
+ * through Lexer::next, and as a bare maximal munch over its tables,
+ * which leaves out tokens, locations, keyword lookups and interning.
+ */
+
+typedef chrono::steady_clock Clock;
+
+const int ROUNDS = 20;
+
+string generate(){
+  const char * words[] = {
+    "if", "break", "continue", "while", "def", "else", "int", "void",
+    "return", "i", "iff", "define", "returned", "whilst", "elsewhere",
+    "counter", "value_1", "x"
+  };
+  int n = sizeof words / sizeof *words;
+
+  string res;
+  unsigned seed = 1;
+  while(res.size() < (16u << 20)){
+    seed = seed * 1103515245u + 12345u;
+    res += words[(seed >> 16) % n];
+    res += (seed >> 8) % 8 ? " " : ";\n";
+  }
+  return res;
+}
+
+// visible tokens, by the same longest match Lexer::next makes
+size_t munch(const LexerTables & t, const string & input){
+  const char * p = input.data();
+  size_t n = input.size(), i = 0, tokens = 0;
+  while(i < n){
+    int cur = 0, rule = -1;
+    size_t end = i;
+    for(size_t j = i; j < n; ){
+      cur = t.next[cur * t.classes + t.class_map[(unsigned char)p[j++]]];
+      if(cur < 0)
+        break;
+      if(t.final[cur]){
+        end = j;
+        rule = t.tag[cur];
+      }
+    }
+
+    if(rule < 0){
+      tokens++;
+      i++;
+      continue;
+    }
+    tokens += !t.hidden[rule];
+    i = end;
+  }
+  return tokens;
+}
+
+double ns_per_byte(Clock::time_point start, const string & input){
+  double ns = chrono::duration<double, nano>(Clock::now() - start).count();
+  return ns / ROUNDS / input.size();
+}
+
+void bench_lexing(const string & input, bool keyword_rules, const char * name){
+  Lexer lexer;
+  setup_def_lexer(lexer, keyword_rules);
+  LexerTables t = lexer.tables();
+
+  size_t tokens = 0;
+  auto start = Clock::now();
+  for(int i = 0; i < ROUNDS; i++){
+    Stream s(input.data(), input.size());
+    Token tok;
+    while(lexer.next(s, tok))
+      tokens++;
+  }
+  double next = ns_per_byte(start, input);
+
+  // read through a volatile so the rounds are not folded into one
+  const string * volatile in = &input;
+  size_t munched = 0;
+  start = Clock::now();
+  for(int i = 0; i < ROUNDS; i++)
+    munched += munch(t, *in);
+  double bare = ns_per_byte(start, input);
+
+  printf("%-13s %4d states  next %6.3f ns/byte  munch %6.3f ns/byte"
+         "  (%zu tokens, %zu munched)\n", name, t.states, next, bare,
+         tokens / ROUNDS, munched / ROUNDS);
+}
+
+int main(int argc, char ** argv){
+  string input;
+  if(argc > 1){
+    ifstream in(argv[1], ifstream::binary);
+    input.assign(istreambuf_iterator<char>(in), istreambuf_iterator<char>());
+  } else {
+    input = generate();
+  }
+
+  if(input.empty()){
+    fprintf(stderr, "empty input\n");
+    return 1;
+  }
+
+  bench_lexing(input, true, "keyword rules");
+  bench_lexing(input, false, "keyword hash");
+  return 0;
+}
@@ -0,0 +1,85 @@
+#include "def_lexer.hpp"
+#include "lexer/regex.hpp"
+#include "lexer/regex_cache.hpp"
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+/*
+ * Compares DFA::minimized methods on the Def lexer rules and on the
+ * regexes of a burlando-formatted input (bench/regex.in by default).
+ */
+
+typedef chrono::steady_clock Clock;
+
+const int ROUNDS = 20;
+
+string unpoint(const string & x){
+  string res;
+  for(char c : x) if(c != '.') res += c;
+  return res;
+}
+
+vector<string> read_corpus(const char * fn){
+  ifstream in(fn);
+  vector<string> res;
+  string R;
+  while(in >> R){
+    res.push_back(unpoint(R));
+    int P;
+    in >> P;
+    getline(in, R);
+    while(P--)
+      getline(in, R);
+  }
+  return res;
+}
+
+double elapsed_ms(Clock::time_point since){
+  return chrono::duration<double, milli>(Clock::now() - since).count();
+}
+
+// rules compile through RegexCache::global(), emptied every round so
+// each one is compiled and minimized again
+void bench_rules(MinimizeMethod method, const char * name){
+  auto start = Clock::now();
+  for(int i = 0; i < ROUNDS; i++){
+    RegexCache::global().clear();
+    Lexer lexer(method);
+    setup_def_lexer(lexer);
+    lexer.build();
+  }
+  printf("def rules   %-11s %9.3f ms/setup\n", name, elapsed_ms(start) / ROUNDS);
+}
+
+void bench_corpus(const vector<string> & corpus, MinimizeMethod method,
+                  const char * name){
+  int states = 0;
+  auto start = Clock::now();
+  for(int i = 0; i < ROUNDS; i++){
+    states = 0;
+    for(const string & r : corpus)
+      states += Regex(r, method).get_dfa().size();
+  }
+  printf("corpus      %-11s %9.3f ms/pass  (%d states)\n", name,
+         elapsed_ms(start) / ROUNDS, states);
+}
+
+int main(int argc, char ** argv){
+  vector<string> corpus = read_corpus(argc > 1 ? argv[1] : "bench/regex.in");
+  if(corpus.empty()){
+    fprintf(stderr, "empty regex corpus\n");
+    return 1;
+  }
+
+  bench_rules(MINIMIZE_BRZOZOWSKI, "brzozowski");
+  bench_rules(MINIMIZE_HOPCROFT, "hopcroft");
+  bench_corpus(corpus, MINIMIZE_BRZOZOWSKI, "brzozowski");
+  bench_corpus(corpus, MINIMIZE_HOPCROFT, "hopcroft");
+  return 0;
+}
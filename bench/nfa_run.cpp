@@ -0,0 +1,74 @@
+#include "lexer/regex.hpp"
+#include "lexer/bitnfa.hpp"
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+/*
+ * BitNFA::run over (a|b)*a(a|b){n}, whose DFA has 2^n states: building
+ * the BitNFA and its step tables, then the runs reusing them, for a
+ * small and a large (some 6000 states) n.
+ */
+
+typedef chrono::steady_clock Clock;
+
+double since(Clock::time_point start){
+  return chrono::duration<double>(Clock::now() - start).count();
+}
+
+NFA nth_from_last(int n){
+  NFA ab = RegexNFA::unite(RegexNFA::from_range(CharRange('a')),
+                           RegexNFA::from_range(CharRange('b')));
+  NFA res = RegexNFA::cat(RegexNFA::kleene(ab), RegexNFA::from_range(CharRange('a')));
+  for(int i = 0; i < n; i++)
+    res = RegexNFA::cat(std::move(res), ab);
+  return res;
+}
+
+void bench(int n, int lines_n){
+  NFA nfa = nth_from_last(n);
+
+  vector<string> lines;
+  unsigned seed = 3;
+  for(int i = 0; i < lines_n; i++){
+    seed = seed * 1103515245u + 12345u;
+    int len = n + 1 + (seed >> 16) % 64;
+    string s;
+    for(int j = 0; j < len; j++){
+      seed = seed * 1103515245u + 12345u;
+      s += "ab"[(seed >> 16) & 1];
+    }
+    lines.push_back(s);
+  }
+
+  auto start = Clock::now();
+  BitNFA bits(nfa);
+  bits.precompute_steps();
+  double build = since(start);
+
+  int accepted = 0, wrong = 0;
+  size_t bytes = 0;
+  start = Clock::now();
+  for(int i = 0; i < lines_n; i++){
+    bool res = bits.run(lines[i]);
+    accepted += res;
+    wrong += res != (lines[i][lines[i].size() - n - 1] == 'a');
+    bytes += lines[i].size();
+  }
+  double s = since(start);
+
+  printf("n=%-5d %6d states %6d positions  build %9.3f ms  then %8.2f us/call"
+         "  %7.2f ns/byte  (%d accepted, %d wrong)\n",
+         n, nfa.size(), bits.size(), build * 1e3, s / lines_n * 1e6,
+         s / bytes * 1e9, accepted, wrong);
+}
+
+int main(){
+  // the active set grows with n, so the large case gets fewer lines
+  bench(8, 1 << 12);
+  bench(1200, 16);
+  return 0;
+}
@@ -0,0 +1,121 @@
+#pragma once
+
+// generated by lexgen from def_lexer.cpp, do not edit
+
+#include "lexer/lexer.hpp"
+
+namespace DefTables{
+
+constexpr int RULES = 11;
+constexpr int STATES = 19;
+constexpr int CLASSES = 15;
+constexpr int16_t KEYWORD_RULE = 258;
+constexpr uint32_t KEYWORD_SEED = 0;
+constexpr int KEYWORD_SLOTS = 32;
+
+constexpr int16_t NAMES[] = {
+  0, 0, 258, 259, 0, 269, 270, 271, 272, 273, 274
+};
+
+constexpr char HIDDEN[] = {
+  1, 1, 0, 0, 0, 0, 0, 0, 0, 0, 0
+};
+
+constexpr uint8_t CLASS_MAP[] = {
+  1, 1, 1, 1, 1, 1, 1, 1, 1, 2, 3, 1, 1, 2, 1, 1,
+  1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+  2, 4, 1, 1, 1, 1, 5, 1, 6, 6, 6, 6, 6, 6, 1, 7,
+  8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 1, 6, 9, 10, 11, 1,
+  1, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12,
+  12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 6, 1, 6, 1, 13,
+  1, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12,
+  12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 6, 14, 6, 1, 1,
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0
+};
+
+constexpr int32_t NEXT[] = {
+  -1, -1, 1, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, -1, 11, -1,
+  -1, 1, 1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+  -1, -1, -1, -1, -1, -1, -1, -1, 12, -1, -1, -1, -1, -1, -1, -1,
+  -1, -1, 13, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+  -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+  -1, -1, 14, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+  -1, -1, 6, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+  -1, -1, -1, 15, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+  -1, -1, 16, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+  -1, 17, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 10, -1,
+  -1, -1, 10, 10, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+  -1, -1, -1, 18, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+  -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+  -1, -1, -1, 14, 14, -1, 14, 14, 14, 14, 14, 14, 14, 14, 14, 14,
+  14, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+  -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+  -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+  -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1
+};
+
+constexpr char FINAL[] = {
+  0, 1, 1, 0, 1, 1, 1, 1, 1, 1, 1, 0, 1, 1, 1, 1,
+  1, 1, 1
+};
+
+constexpr int TAG[] = {
+  -1, 0, 4, -1, 4, 4, 3, 4, 4, 4, 2, -1, 8, 9, 1, 5,
+  7, 6, 10
+};
+
+constexpr const char * KEYWORD_WORDS[] = {
+  "continue",
+  "",
+  "while",
+  "return",
+  "",
+  "",
+  "",
+  "",
+  "",
+  "",
+  "",
+  "",
+  "int",
+  "",
+  "else",
+  "",
+  "",
+  "break",
+  "",
+  "",
+  "",
+  "void",
+  "if",
+  "",
+  "",
+  "",
+  "",
+  "",
+  "",
+  "",
+  "def",
+  ""
+};
+
+constexpr int16_t KEYWORD_TYPES[] = {
+  262, 0, 263, 268, 0, 0, 0, 0, 0, 0, 0, 0, 266, 0, 265, 0,
+  0, 261, 0, 0, 0, 267, 260, 0, 0, 0, 0, 0, 0, 0, 264, 0
+};
+
+inline LexerTables tables(){
+  return {RULES, NAMES, HIDDEN, STATES, CLASSES,
+          CLASS_MAP, NEXT, FINAL, TAG,
+          KEYWORD_RULE, KEYWORD_SEED, KEYWORD_SLOTS,
+          KEYWORD_WORDS, KEYWORD_TYPES};
+}
+
+}
@@ -2,8 +2,14 @@
 #include "lexer/common.hpp"
 #include "lexer/dfa.cpp"
 #include "lexer/nfa.cpp"
+#include "lexer/bitnfa.cpp"
+#include "lexer/lazydfa.cpp"
+#include "lexer/csr.cpp"
+#include "lexer/thompson.cpp"
+#include "lexer/regex_cache.cpp"
 #include "lexer/token.hpp"
 #include "lexer/regex.cpp"
+#include "common/writer.hpp"
 
 using namespace std;
 
@@ -13,23 +19,55 @@ string unpoint(const string & x){
   return res;
 }
 
+// the input is a regex, a line count P and P lines, over and over. it is
+// read whole, and each regex answers its lines in a single batch.
 int main(){
   ios::sync_with_stdio(false);
-  cin.tie(0);
 
-  string R;
-  while(cin >> R){
-    Regex re(unpoint(R));
-    int P;
-    cin >> P;
+  string in((istreambuf_iterator<char>(cin)), istreambuf_iterator<char>());
+  const char * p = in.data();
+  const char * end = p + in.size();
 
-    getline(cin, R);
-    while(P--){
-      getline(cin, R);
+  BufferedWriter out(stdout);
+  vector<size_t> begin, finish;
+  vector<char> results;
 
-      cout << (re.run(R) ? "Y" : "N") << endl;
+  while(true){
+    while(p < end && isspace((unsigned char)*p)) p++;
+    const char * word = p;
+    while(p < end && !isspace((unsigned char)*p)) p++;
+    if(word == p)
+      break;
+
+    string R(word, p);
+    char * num_end;
+    long P = strtol(p, &num_end, 10);
+    p = num_end;
+
+    // the rest of the line holding P is ignored
+    const char * nl = (const char *)memchr(p, '\n', end - p);
+    p = nl ? nl + 1 : end;
+
+    begin.clear();
+    finish.clear();
+    for(long i = 0; i < P && p < end; i++){
+      nl = (const char *)memchr(p, '\n', end - p);
+      begin.push_back(p - in.data());
+      finish.push_back((nl ? nl : end) - in.data());
+      p = nl ? nl + 1 : end;
     }
 
-    cout << endl;
+    // flat-table DFAs match the batch interleaved; only patterns whose
+    // DFA outgrows the lazy cache are matched lazily, line by line
+    shared_ptr<const Regex> re = RegexCache::global().get(unpoint(R), REGEX_AUTO);
+    results.resize(begin.size());
+    re->run_batch(in.data(), begin.data(), finish.data(), begin.size(),
+                  results.data());
+
+    for(char r : results){
+      out.put(r ? 'Y' : 'N');
+      out.put('\n');
+    }
+    out.put('\n');
   }
 }
@@ -5,6 +5,24 @@
 #include <cstdio>
 
 const int WORD = 4;
+
+// operators of the language; OP_SUB doubles as unary minus
+enum Operator : unsigned char {
+  OP_ADD, OP_SUB, OP_MUL, OP_DIV,
+  OP_EQ, OP_NEQ, OP_LT, OP_GT, OP_LEQ, OP_GEQ,
+  OP_AND, OP_OR, OP_NOT,
+  OP_INVALID
+};
+
+inline const char * operator_text(Operator op){
+  static const char * texts[] = {
+    "+", "-", "*", "/",
+    "==", "!=", "<", ">", "<=", ">=",
+    "&&", "||", "!",
+    "?"
+  };
+  return texts[op];
+}
 const std::string GLOBALS_LABEL = "globals__";
 const std::string ENTRY_POINT_LABEL = "main";
 const std::string LABEL_PREFIX = "_lb_";
@@ -166,43 +184,56 @@ struct Code{
 
   // operations
   void emit_binary_operation(std::string res, std::string r1,
-                              std::string r2, std::string type){
+                              std::string r2, Operator op){
       #define BINARY_PARAMS res.c_str(), r1.c_str(), r2.c_str()
       #define SELF_RES res.c_str(), res.c_str()
 
-      if(type == "+")
+      switch(op){
+      case OP_ADD:
         emitf("addu $%s, $%s, $%s", BINARY_PARAMS);
-      else if(type == "-")
+        break;
+      case OP_SUB:
         emitf("subu $%s, $%s, $%s", BINARY_PARAMS);
-      else if(type == "*")
+        break;
+      case OP_MUL:
         emitf("mul $%s, $%s, $%s", BINARY_PARAMS); // macro by mips assembler
-      else if(type == "/")
+        break;
+      case OP_DIV:
         emitf("div $%s, $%s, $%s", BINARY_PARAMS); // "     "       "
-      else if(type == "=="){
+        break;
+      case OP_EQ:
         emitf("xor $%s, $%s, $%s", BINARY_PARAMS);
         emit_to_bool(res);
         emit_not(res);
-      } else if(type == "!="){
+        break;
+      case OP_NEQ:
         emitf("xor $%s, $%s, $%s", BINARY_PARAMS);
         emit_to_bool(res);
-      } else if(type == "&&"){
+        break;
+      case OP_AND:
         emit_to_bool("t1", r1);
         emit_to_bool("t2", r2);
         emitf("and $%s, $t1, $t2", res.c_str());
-      } else if(type == "||"){
+        break;
+      case OP_OR:
         emitf("or $%s, $%s, $%s", BINARY_PARAMS);
         emit_to_bool(res);
-      } else if(type == "<"){
+        break;
+      case OP_LT:
         emitf("slt $%s, $%s, $%s", BINARY_PARAMS);
-      } else if(type == ">"){
+        break;
+      case OP_GT:
         emitf("slt $%s, $%s, $%s", res.c_str(), r2.c_str(), r1.c_str());
-      } else if(type == "<="){
+        break;
+      case OP_LEQ:
         emitf("slt $%s, $%s, $%s", res.c_str(), r2.c_str(), r1.c_str());
         emit_not(res);
-      } else if(type == ">="){
+        break;
+      case OP_GEQ:
         emitf("slt $%s, $%s, $%s", BINARY_PARAMS);
         emit_not(res);
-      } else {
+        break;
+      default:
         throw std::runtime_error(
           "invalid type of binary operator during code generation");
       }
@@ -210,25 +241,28 @@ struct Code{
       #undef BINARY_PARAMS
   }
 
-  void emit_binary_operation(std::string res, std::string reg, std::string type){
-    emit_binary_operation(res, res, reg, type);
+  void emit_binary_operation(std::string res, std::string reg, Operator op){
+    emit_binary_operation(res, res, reg, op);
   }
 
-  void emit_unary_operation(std::string res, std::string reg, std::string type){
-    if(type == "-"){
+  void emit_unary_operation(std::string res, std::string reg, Operator op){
+    switch(op){
+    case OP_SUB:
       emitf("not $%s, $%s", res.c_str(), reg.c_str());
       emitf("addiu $%s, $%s, 1", res.c_str(), res.c_str());
-    } else if(type == "!"){
+      break;
+    case OP_NOT:
       emit_to_bool(res, reg);
       emit_not(res);
-    } else{
+      break;
+    default:
       throw std::runtime_error(
         "invalid type of unary operator during code generation");
     }
   }
 
-  void emit_unary_operation(std::string reg, std::string type){
-    emit_unary_operation(reg, reg, type);
+  void emit_unary_operation(std::string reg, Operator op){
+    emit_unary_operation(reg, reg, op);
   }
   //
 
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <cstdio>
+
+// Thrown to abandon a pass once the error limit has been reached; the
+// errors themselves have been reported already.
+struct ErrorLimit {};
+
+// Counts the errors reported on a run, printing each one as it comes.
+// With a limit above one, callers are expected to recover and go on
+// until the limit is reached.
+class ErrorLog {
+private:
+  int m_max;
+  int m_count = 0;
+
+public:
+  ErrorLog(int max = 1) : m_max(max) {}
+
+  void set_max(int max) { m_max = max; }
+  int max() const { return m_max; }
+  int count() const { return m_count; }
+
+  bool recovering() const { return m_max > 1; }
+
+  // prints msg, returning false once the limit has been reached
+  bool report(const char * msg){
+    fprintf(stderr, "%s\n", msg);
+    return ++m_count < m_max;
+  }
+};
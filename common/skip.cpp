@@ -0,0 +1,153 @@
+#include "skip.hpp"
+#include <cstring>
+
+#ifdef __x86_64__
+#include <immintrin.h>
+#define SKIP_X86
+#endif
+
+// ranges of the bytes with the given membership, false past SKIP_RANGES
+static bool collect(ByteRanges & r, const bool skips[256], bool member){
+  r.count = 0;
+  for(int b = 0; b < 256; b++){
+    if(skips[b] != member)
+      continue;
+    if(r.count && r.hi[r.count-1] == b - 1){
+      r.hi[r.count-1] = b;
+      continue;
+    }
+    if(r.count == SKIP_RANGES)
+      return false;
+    r.lo[r.count] = r.hi[r.count] = b;
+    r.count++;
+  }
+  return true;
+}
+
+bool ByteRanges::build(const bool skips[256]){
+  memcpy(this->skips, skips, sizeof this->skips);
+
+  ByteRanges in, out;
+  bool has_in = collect(in, skips, true);
+  bool has_out = collect(out, skips, false);
+  if(!has_in && !has_out)
+    return false;
+
+  this->stop = !has_in || (has_out && out.count < in.count);
+  const ByteRanges & r = this->stop ? out : in;
+  this->count = r.count;
+  memcpy(this->lo, r.lo, sizeof this->lo);
+  memcpy(this->hi, r.hi, sizeof this->hi);
+  return true;
+}
+
+static void push_newlines(uint32_t mask, std::vector<size_t> * newlines,
+                          size_t base){
+  while(mask){
+    newlines->push_back(base + __builtin_ctz(mask));
+    mask &= mask - 1;
+  }
+}
+
+static size_t skip_scalar(const ByteRanges & r, const char * p,
+                          const char * end, std::vector<size_t> * newlines,
+                          size_t base){
+  const char * q = p;
+  while(q < end && r.skips[(unsigned char)*q]){
+    if(newlines && *q == '\n')
+      newlines->push_back(base + (q - p));
+    q++;
+  }
+  return q - p;
+}
+
+#ifdef SKIP_X86
+// b is in [lo, hi] iff b - lo <= hi - lo, unsigned
+static size_t skip_sse2(const ByteRanges & r, const char * p,
+                        const char * end, std::vector<size_t> * newlines,
+                        size_t base){
+  __m128i lo[SKIP_RANGES], width[SKIP_RANGES];
+  for(int i = 0; i < r.count; i++){
+    lo[i] = _mm_set1_epi8(r.lo[i]);
+    width[i] = _mm_set1_epi8(r.hi[i] - r.lo[i]);
+  }
+  const __m128i nl = _mm_set1_epi8('\n');
+
+  const char * q = p;
+  for(; end - q >= 16; q += 16){
+    __m128i v = _mm_loadu_si128((const __m128i *)q);
+    __m128i in = _mm_setzero_si128();
+    for(int i = 0; i < r.count; i++){
+      __m128i d = _mm_sub_epi8(v, lo[i]);
+      in = _mm_or_si128(in, _mm_cmpeq_epi8(_mm_min_epu8(d, width[i]), d));
+    }
+
+    uint32_t mask = _mm_movemask_epi8(in);
+    uint32_t ends = (r.stop ? mask : ~mask) & 0xffff;
+    uint32_t run = ends ? (1u << __builtin_ctz(ends)) - 1 : 0xffff;
+
+    if(newlines)
+      push_newlines(_mm_movemask_epi8(_mm_cmpeq_epi8(v, nl)) & run,
+                    newlines, base + (q - p));
+    if(ends)
+      return (q - p) + __builtin_ctz(ends);
+  }
+
+  return (q - p) + skip_scalar(r, q, end, newlines, base + (q - p));
+}
+
+__attribute__((target("avx2")))
+static size_t skip_avx2(const ByteRanges & r, const char * p,
+                        const char * end, std::vector<size_t> * newlines,
+                        size_t base){
+  __m256i lo[SKIP_RANGES], width[SKIP_RANGES];
+  for(int i = 0; i < r.count; i++){
+    lo[i] = _mm256_set1_epi8(r.lo[i]);
+    width[i] = _mm256_set1_epi8(r.hi[i] - r.lo[i]);
+  }
+  const __m256i nl = _mm256_set1_epi8('\n');
+
+  const char * q = p;
+  for(; end - q >= 32; q += 32){
+    __m256i v = _mm256_loadu_si256((const __m256i *)q);
+    __m256i in = _mm256_setzero_si256();
+    for(int i = 0; i < r.count; i++){
+      __m256i d = _mm256_sub_epi8(v, lo[i]);
+      in = _mm256_or_si256(in,
+        _mm256_cmpeq_epi8(_mm256_min_epu8(d, width[i]), d));
+    }
+
+    uint32_t mask = _mm256_movemask_epi8(in);
+    uint32_t ends = r.stop ? mask : ~mask;
+    uint32_t run = ends ? (1u << __builtin_ctz(ends)) - 1 : 0xffffffffu;
+
+    if(newlines)
+      push_newlines(_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, nl)) & run,
+                    newlines, base + (q - p));
+    if(ends)
+      return (q - p) + __builtin_ctz(ends);
+  }
+
+  return (q - p) + skip_sse2(r, q, end, newlines, base + (q - p));
+}
+#endif
+
+typedef size_t (*SkipKernel)(const ByteRanges &, const char *, const char *,
+                             std::vector<size_t> *, size_t);
+
+static SkipKernel pick_kernel(){
+#ifdef SKIP_X86
+  __builtin_cpu_init();
+  if(__builtin_cpu_supports("avx2"))
+    return skip_avx2;
+  if(__builtin_cpu_supports("sse2"))
+    return skip_sse2;
+#endif
+  return skip_scalar;
+}
+
+size_t skip_bytes(const ByteRanges & r, const char * p, const char * end,
+                  std::vector<size_t> * newlines, size_t base){
+  static const SkipKernel kernel = pick_kernel();
+  return kernel(r, p, end, newlines, base);
+}
@@ -0,0 +1,25 @@
+#pragma once
+
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+#define SKIP_RANGES 4
+
+// A set of bytes given by up to SKIP_RANGES inclusive ranges, either of
+// the bytes to skip or, when stop is set, of the bytes that end the run.
+struct ByteRanges {
+  bool stop = false;
+  int count = 0;
+  uint8_t lo[SKIP_RANGES], hi[SKIP_RANGES];
+
+  bool skips[256]; // the same set, for the scalar paths
+
+  // describes the bytes marked in skips, false if it takes too many ranges
+  bool build(const bool skips[256]);
+};
+
+// length of the run of skipped bytes in [p, end). offsets of the '\n'
+// inside the run are appended to newlines, shifted by base, if given.
+size_t skip_bytes(const ByteRanges &, const char * p, const char * end,
+                  std::vector<size_t> * newlines = 0, size_t base = 0);
@@ -1,31 +1,114 @@
 #include "stream.hpp"
+#include <iterator>
+#include <algorithm>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 
-char Stream::peek(){
-  return s.peek();
+Stream::Stream(std::istream & s){
+  m_owned.assign(std::istreambuf_iterator<char>(s),
+                 std::istreambuf_iterator<char>());
+  this->adopt(m_owned.data(), m_owned.size());
 }
 
-char Stream::get(){
-  char c = s.get();
-  col++;
-  if(c == '\n'){
-    cols.push_back(col);
-    line++;
-    col = 0;
+Stream::Stream(const char * filename){
+  int fd = open(filename, O_RDONLY);
+  if(fd < 0)
+    return;
+
+  struct stat st;
+  if(fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0){
+    void * p = mmap(0, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if(p != MAP_FAILED){
+      m_map = p;
+      m_map_size = st.st_size;
+      madvise(p, st.st_size, MADV_SEQUENTIAL);
+      this->adopt((const char *)p, st.st_size);
+      close(fd);
+      return;
+    }
   }
 
-  return c;
+  // pipes, empty files or a failed mmap: read everything
+  char buf[1<<16];
+  ssize_t got;
+  while((got = read(fd, buf, sizeof buf)) > 0)
+    m_owned.append(buf, got);
+
+  close(fd);
+  if(got == 0)
+    this->adopt(m_owned.data(), m_owned.size());
+}
+
+Stream::Stream(const char * data, size_t n){
+  this->adopt(data, n);
 }
 
-void Stream::unget(){
-  s.unget();
+Stream::~Stream(){
+  if(m_map)
+    munmap(m_map, m_map_size);
+}
+
+void Stream::adopt(const char * p, size_t n){
+  m_begin = m_ptr = p;
+  m_end = p + n;
+  m_open = true;
+}
 
-  if(--col < 0){
-    line--;
-    col = cols.back()-1;
-    cols.pop_back();
+// extends the newline index up to off
+void Stream::index(size_t off){
+  while(m_indexed < off){
+    const char * nl = (const char *)memchr(m_begin + m_indexed, '\n',
+                                           off - m_indexed);
+    if(!nl){
+      m_indexed = off;
+      break;
+    }
+    m_newlines.push_back(nl - m_begin);
+    m_indexed = nl - m_begin + 1;
   }
 }
 
+// the newlines of the run are indexed while skipping it, unless the
+// index is already past this point after a backtrack
+size_t Stream::skip(const ByteRanges & r){
+  // most runs are empty or short; do not set up a kernel for nothing
+  if(m_ptr == m_end || !r.skips[(unsigned char)*m_ptr])
+    return 0;
+
+  size_t off = this->offset();
+  this->index(off);
+
+  bool indexing = m_indexed == off;
+  size_t n = skip_bytes(r, m_ptr, m_end, indexing ? &m_newlines : 0, off);
+  m_ptr += n;
+  if(indexing)
+    m_indexed = off + n;
+  return n;
+}
+
 std::pair<int, int> Stream::location(){
-  return {line, col};
+  return this->location(this->offset());
+}
+
+// 1-based line and the number of characters before off on that line.
+// offsets mostly come in order, a few lines apart, so the search goes on
+// from the previous line before falling back to a binary search.
+std::pair<int, int> Stream::location(size_t off){
+  this->index(off);
+
+  size_t before = m_line, n = m_newlines.size();
+  if(before && m_newlines[before-1] >= off)
+    before = 0;
+  for(int i = 0; i < 8 && before < n && m_newlines[before] < off; i++)
+    before++;
+  if(before < n && m_newlines[before] < off)
+    before = lower_bound(m_newlines.begin() + before, m_newlines.end(), off)
+             - m_newlines.begin();
+  m_line = before;
+
+  size_t line_start = before ? m_newlines[before-1] + 1 : 0;
+  return {(int)before + 1, (int)(off - line_start)};
 }
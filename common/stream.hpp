@@ -1,19 +1,68 @@
 #pragma once
 
 #include <iostream>
+#include <string>
 #include <vector>
+#include <cstddef>
+#include <cstdio>
+#include "skip.hpp"
 
+// The whole input as one contiguous buffer: a memory-mapped file when
+// possible, otherwise a copy of everything read from the stream.
 class Stream {
 private:
-  std::istream & s;
-  int line = 1, col = 0;
-  std::vector<int> cols;
+  const char * m_begin = 0;
+  const char * m_end = 0;
+  const char * m_ptr = 0;
+
+  std::string m_owned;
+  void * m_map = 0;
+  size_t m_map_size = 0;
+  bool m_open = false;
+
+  // offsets of every '\n' before m_indexed, extended on demand
+  std::vector<size_t> m_newlines;
+  size_t m_indexed = 0;
+  // newlines before the last offset located, where the next search starts
+  size_t m_line = 0;
+
+  void adopt(const char *, size_t);
+  void index(size_t off);
 
 public:
-  Stream(std::istream & s) : s(s) {}
+  Stream(std::istream & s);
+  Stream(const char * filename);
+  Stream(const char * data, size_t n);
+  ~Stream();
+
+  Stream(const Stream &) = delete;
+  Stream & operator=(const Stream &) = delete;
+
+  bool is_open() const { return m_open; }
+
+  const char * data() const { return m_begin; }
+  size_t size() const { return m_end - m_begin; }
+  size_t offset() const { return m_ptr - m_begin; }
+
+  char peek(){
+    return m_ptr < m_end ? *m_ptr : EOF;
+  }
+
+  char get(){
+    return m_ptr < m_end ? *m_ptr++ : EOF;
+  }
+
+  void unget(){
+    m_ptr--;
+  }
+
+  // backtracking is just moving back to an earlier offset
+  size_t mark() const { return this->offset(); }
+  void reset(size_t off) { m_ptr = m_begin + off; }
+
+  // moves past the run of bytes in r, returning its length
+  size_t skip(const ByteRanges & r);
 
-  char peek();
-  char get();
-  void unget();
   std::pair<int, int> location();
+  std::pair<int, int> location(size_t off);
 };
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstdio>
+#include <cstring>
+
+// Collects output in a fixed buffer and hands it to a FILE in large
+// writes, flushing when full and on destruction.
+class BufferedWriter {
+private:
+  FILE * m_out;
+  char m_buf[1<<16];
+  size_t m_size = 0;
+
+public:
+  BufferedWriter(FILE * out) : m_out(out) {}
+  ~BufferedWriter() { this->flush(); }
+
+  BufferedWriter(const BufferedWriter &) = delete;
+  BufferedWriter & operator=(const BufferedWriter &) = delete;
+
+  void put(char c){
+    if(m_size == sizeof m_buf)
+      this->flush();
+    m_buf[m_size++] = c;
+  }
+
+  void write(const char * s, size_t n){
+    if(n > sizeof m_buf - m_size){
+      this->flush();
+      if(n >= sizeof m_buf){
+        fwrite(s, 1, n, m_out);
+        return;
+      }
+    }
+    memcpy(m_buf + m_size, s, n);
+    m_size += n;
+  }
+
+  void flush(){
+    if(m_size)
+      fwrite(m_buf, 1, m_size, m_out);
+    m_size = 0;
+    fflush(m_out);
+  }
+};
@@ -0,0 +1,90 @@
+#include "def_lexer.hpp"
+#include "parser.hpp"
+#include <string>
+#include <vector>
+
+std::string unite(std::vector<std::string> s){
+  std::string res;
+  for(std::string x : s){
+    res += x;
+    res += '|';
+  }
+
+  if(!s.empty())
+    res.pop_back();
+
+  return res;
+}
+
+std::string escape(const std::string & s){
+  std::string res;
+  for(char c : s){
+    res += "\\";
+    res += c;
+  }
+  return res;
+}
+
+std::vector<std::string> escape(std::vector<std::string> s){
+  for(std::string & x : s){
+    x = escape(x);
+  }
+
+  return s;
+}
+
+void setup_def_lexer(Lexer & lexer, bool keyword_rules){
+  std::vector<std::string> syms = {
+    "(",
+    "{",
+    "[",
+    "]",
+    "}",
+    ")",
+    ",",
+    ";",
+    "=",
+    "+",
+    "-",
+    "*",
+    "/",
+    "<",
+    ">",
+    "!"
+  };
+
+  syms = escape(syms);
+
+  lexer.add_hidden_rule(0, "[ \n\t\r]+"); // white
+  lexer.add_hidden_rule(0, "//[^\n]*"); // comment
+
+  std::vector<std::pair<std::string, int16_t>> keywords = {
+    {"if", T_IF},
+    {"break", T_BREAK},
+    {"continue", T_CONTINUE},
+    {"while", T_WHILE},
+    {"def", T_DEF},
+    {"else", T_ELSE},
+    {"int", T_INT},
+    {"void", T_VOID},
+    {"return", T_RETURN}
+  };
+
+  for(const auto & kw : keywords){
+    if(keyword_rules)
+      lexer.add_rule(kw.second, escape(kw.first));
+    else
+      lexer.add_keyword(T_ID, kw.first, kw.second);
+  }
+
+  lexer.add_rule(T_ID, "[a-zA-Z][a-zA-Z0-9_]*");
+  lexer.add_rule(T_DEC, "[0-9]+");
+  lexer.add_rule(0, unite(syms));
+
+  lexer.add_rule(T_LEQ, escape("<="));
+  lexer.add_rule(T_GEQ, escape(">="));
+  lexer.add_rule(T_EQ, escape("=="));
+  lexer.add_rule(T_NEQ, escape("!="));
+  lexer.add_rule(T_AND, escape("&&"));
+  lexer.add_rule(T_OR, escape("||"));
+}
@@ -0,0 +1,7 @@
+#pragma once
+
+#include "lexer/lexer.hpp"
+
+// registers the token rules of the Def language. keywords are looked up
+// among identifiers, unless keyword_rules asks for a DFA rule for each.
+void setup_def_lexer(Lexer &, bool keyword_rules = false);
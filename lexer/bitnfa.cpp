@@ -0,0 +1,177 @@
+#include "bitnfa.hpp"
+#include <algorithm>
+#include <limits>
+
+BitNFA::BitNFA(const CsrAutomaton & nfa){
+  m_states = nfa.size();
+
+  std::vector<CharRange> input_symbols;
+  std::vector<int> position(m_states, -1);
+  m_size = 0;
+  for(int i = 0; i < m_states; i++){
+    bool moves = false;
+    for(auto e = nfa.edges_begin(i); e != nfa.edges_end(i); e++){
+      if(!e->range.in_range(EPSILON)){
+        input_symbols.push_back(e->range);
+        moves = true;
+      }
+    }
+
+    if(moves || nfa.is_final(i) || nfa.tag(i) != NO_TAG)
+      position[i] = m_size++;
+  }
+
+  m_words = Bitset::words(m_size);
+  m_alphabet = get_disjoint_ranges(input_symbols);
+  for(int b = 0; b < 256; b++)
+    m_byte_symbols[b] = this->symbol((char)b);
+
+  // epsilon closures, by a dfs from every state
+  m_closures.assign((size_t)m_states * m_words, 0);
+  std::vector<int> stack, seen(m_states, -1);
+  for(int i = 0; i < m_states; i++){
+    BitWord * cl = &m_closures[(size_t)i * m_words];
+    seen[i] = i;
+    stack.push_back(i);
+
+    while(!stack.empty()){
+      int cur = stack.back();
+      stack.pop_back();
+      if(position[cur] >= 0)
+        Bitset::set(cl, position[cur]);
+
+      for(auto e = nfa.edges_begin(cur); e != nfa.edges_end(cur); e++){
+        if(e->range.in_range(EPSILON) && seen[e->to] != i){
+          seen[e->to] = i;
+          stack.push_back(e->to);
+        }
+      }
+    }
+  }
+
+  m_moves.resize(m_size);
+  m_final.resize(m_size);
+  m_tag.resize(m_size);
+
+  for(int i = 0; i < m_states; i++){
+    int p = position[i];
+    if(p < 0)
+      continue;
+
+    m_final[p] = nfa.is_final(i);
+    m_tag[p] = nfa.tag(i);
+
+    for(auto e = nfa.edges_begin(i); e != nfa.edges_end(i); e++){
+      if(e->range.in_range(EPSILON))
+        continue;
+
+      int lo = lower_bound(m_alphabet.begin(), m_alphabet.end(),
+                           CharRange(e->range.left)) - m_alphabet.begin();
+      int hi = lo;
+      while(hi < (int)m_alphabet.size() && m_alphabet[hi].left <= e->range.right)
+        hi++;
+
+      m_moves[p].push_back({lo, hi, e->to});
+    }
+  }
+}
+
+int BitNFA::symbol(LABEL c) const{
+  auto it = upper_bound(m_alphabet.begin(), m_alphabet.end(),
+                        CharRange(c, std::numeric_limits<LABEL>::max()));
+  if(it == m_alphabet.begin() || !(--it)->in_range(c))
+    return -1;
+  return it - m_alphabet.begin();
+}
+
+void BitNFA::initial(BitWord * to) const{
+  Bitset::clear(to, m_words);
+  if(m_states)
+    Bitset::unite(to, this->closure(0), m_words);
+}
+
+void BitNFA::precompute_steps(){
+  int k = this->symbols();
+  bool full = (size_t)k * m_size * m_words <= BITNFA_STEP_WORDS;
+  m_steps.assign(full ? (size_t)k * m_size * m_words : 0, 0);
+  m_movers.assign((size_t)k * m_words, 0);
+
+  for(int i = 0; i < m_size; i++){
+    for(const Move & mv : m_moves[i]){
+      for(int a = mv.lo; a < mv.hi; a++){
+        Bitset::set(&m_movers[a * m_words], i);
+        if(full)
+          Bitset::unite(&m_steps[((size_t)a * m_size + i) * m_words],
+                        this->closure(mv.to), m_words);
+      }
+    }
+  }
+}
+
+void BitNFA::step(const BitWord * from, int symbol, BitWord * to) const{
+  Bitset::clear(to, m_words);
+
+  if(!m_movers.empty()){
+    const BitWord * movers = &m_movers[symbol * m_words];
+    const BitWord * steps = m_steps.empty() ? 0
+      : &m_steps[(size_t)symbol * m_size * m_words];
+    for(int w = 0; w < m_words; w++){
+      BitWord x = from[w] & movers[w];
+      while(x){
+        int i = w * 64 + __builtin_ctzll(x);
+        x &= x - 1;
+        if(steps){
+          Bitset::unite(to, steps + (size_t)i * m_words, m_words);
+          continue;
+        }
+        for(const Move & mv : m_moves[i]){
+          if(mv.lo <= symbol && symbol < mv.hi)
+            Bitset::unite(to, this->closure(mv.to), m_words);
+        }
+      }
+    }
+    return;
+  }
+
+  Bitset::for_each(from, m_words, [&](int i){
+    for(const Move & mv : m_moves[i]){
+      if(mv.lo <= symbol && symbol < mv.hi)
+        Bitset::unite(to, this->closure(mv.to), m_words);
+    }
+  });
+}
+
+bool BitNFA::is_final(const BitWord * s) const{
+  bool res = false;
+  Bitset::for_each(s, m_words, [&](int i){ res |= m_final[i]; });
+  return res;
+}
+
+int BitNFA::tag(const BitWord * s) const{
+  int res = NO_TAG;
+  Bitset::for_each(s, m_words, [&](int i){ res = merge_tags(res, m_tag[i]); });
+  return res;
+}
+
+bool BitNFA::run(const std::string & s) const{
+  if(!m_states)
+    return false;
+
+  std::vector<BitWord> buf(2 * m_words);
+  BitWord * cur = buf.data();
+  BitWord * next = cur + m_words;
+
+  this->initial(cur);
+  for(char c : s){
+    int a = this->byte_symbol(c);
+    if(a < 0)
+      return false;
+
+    this->step(cur, a, next);
+    if(Bitset::empty(next, m_words))
+      return false;
+    std::swap(cur, next);
+  }
+
+  return this->is_final(cur);
+}
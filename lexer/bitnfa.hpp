@@ -0,0 +1,83 @@
+#pragma once
+
+#include "common.hpp"
+#include "bitset.hpp"
+#include "nfa.hpp"
+#include "csr.hpp"
+#include <string>
+#include <vector>
+
+// budget, in words, for the quadratic step table of precompute_steps()
+#define BITNFA_STEP_WORDS (1 << 22)
+
+// An NFA prepared for set-at-a-time simulation: epsilon closures are
+// precomputed as bitsets and every transition is expressed over the
+// disjoint input alphabet, so a set of states moves on a symbol index.
+//
+// Sets only hold the states that matter once closed: those that move on
+// some input, accept or carry a tag. They are numbered 0..size()-1 in
+// state order; the states moves lead to keep their NFA numbers, as
+// only their closures are ever looked at.
+//
+// A step unites the closed targets of the active states that move on
+// the symbol, O(a * size() / 64) for a such states, so O(size()^2 / 64)
+// at worst. Shift-and simulation gets a step down to O(size() / 64),
+// but only for NFAs whose moves all go from one state to the next,
+// which Thompson NFAs with loops and alternations are not.
+class BitNFA{
+public:
+  struct Move{
+    int lo, hi; // alphabet symbols [lo, hi)
+    int to; // NFA state
+  };
+
+private:
+  int m_states, m_size, m_words;
+  std::vector<CharRange> m_alphabet;
+  std::vector<BitWord> m_closures; // [NFA state * m_words]
+  std::vector<std::vector<Move>> m_moves;
+  std::vector<char> m_final;
+  std::vector<int> m_tag;
+  int m_byte_symbols[256];
+
+  // filled by precompute_steps(): the states moving at all on each
+  // symbol, [symbol * m_words], and, within BITNFA_STEP_WORDS, the
+  // closed targets of every position on every symbol,
+  // [(symbol * m_size + position) * m_words]
+  std::vector<BitWord> m_steps;
+  std::vector<BitWord> m_movers;
+
+public:
+  BitNFA(const CsrAutomaton &);
+  BitNFA(const NFA & nfa) : BitNFA(CsrAutomaton(nfa)) {}
+
+  int states() const { return m_states; }
+  int size() const { return m_size; }
+  int words() const { return m_words; }
+  int symbols() const { return m_alphabet.size(); }
+
+  const std::vector<CharRange> & alphabet() const { return m_alphabet; }
+  const std::vector<Move> & moves(int i) const { return m_moves[i]; }
+
+  // of an NFA state, e.g. Move::to
+  const BitWord * closure(int state) const {
+    return &m_closures[(size_t)state * m_words];
+  }
+
+  // alphabet index holding c, or -1
+  int symbol(LABEL c) const;
+  int byte_symbol(char c) const { return m_byte_symbols[(unsigned char)c]; }
+
+  // trades memory for a step() that skips states not moving on the
+  // symbol and, for small automata, is a union of precomputed masks
+  void precompute_steps();
+
+  void initial(BitWord *) const;
+  void step(const BitWord * from, int symbol, BitWord * to) const;
+
+  // whether the whole of s is accepted
+  bool run(const std::string & s) const;
+
+  bool is_final(const BitWord *) const;
+  int tag(const BitWord *) const;
+};
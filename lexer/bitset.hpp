@@ -0,0 +1,126 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <cstring>
+
+typedef uint64_t BitWord;
+
+// helpers over fixed-width bitsets stored as plain BitWord arrays
+namespace Bitset{
+  inline int words(int n){
+    return (n + 63) / 64;
+  }
+
+  inline void set(BitWord * s, int i){
+    s[i >> 6] |= (BitWord)1 << (i & 63);
+  }
+
+  inline bool test(const BitWord * s, int i){
+    return (s[i >> 6] >> (i & 63)) & 1;
+  }
+
+  inline void clear(BitWord * s, int w){
+    memset(s, 0, w * sizeof(BitWord));
+  }
+
+  inline void unite(BitWord * s, const BitWord * t, int w){
+    for(int i = 0; i < w; i++)
+      s[i] |= t[i];
+  }
+
+  inline bool empty(const BitWord * s, int w){
+    for(int i = 0; i < w; i++)
+      if(s[i])
+        return false;
+    return true;
+  }
+
+  inline bool equal(const BitWord * s, const BitWord * t, int w){
+    return !memcmp(s, t, w * sizeof(BitWord));
+  }
+
+  inline uint64_t hash(const BitWord * s, int w){
+    uint64_t h = 0x9e3779b97f4a7c15ULL;
+    for(int i = 0; i < w; i++){
+      h ^= s[i] + 0x9e3779b97f4a7c15ULL + (h << 6) + (h >> 2);
+      h *= 0xff51afd7ed558ccdULL;
+    }
+    return h ^ (h >> 33);
+  }
+
+  template<typename F>
+  inline void for_each(const BitWord * s, int w, F f){
+    for(int i = 0; i < w; i++){
+      BitWord x = s[i];
+      while(x){
+        f(i * 64 + __builtin_ctzll(x));
+        x &= x - 1;
+      }
+    }
+  }
+}
+
+// interns bitsets of a fixed width, handing out dense indices in
+// insertion order. open addressing with linear probing.
+class StateSetTable{
+private:
+  int m_words;
+  std::vector<BitWord> m_sets;
+  std::vector<uint64_t> m_hashes;
+  std::vector<int> m_slots;
+
+  void grow(){
+    std::vector<int> slots(m_slots.empty() ? 64 : 2 * m_slots.size(), -1);
+    size_t mask = slots.size() - 1;
+    for(int i = 0; i < this->size(); i++){
+      size_t p = m_hashes[i] & mask;
+      while(slots[p] != -1)
+        p = (p + 1) & mask;
+      slots[p] = i;
+    }
+    m_slots.swap(slots);
+  }
+
+public:
+  StateSetTable(int words) : m_words(words) {}
+
+  int size() const {
+    return m_hashes.size();
+  }
+
+  const BitWord * get(int i) const {
+    return &m_sets[i * m_words];
+  }
+
+  // returns the index of s, adding it if it is new
+  int insert(const BitWord * s, bool * inserted = 0){
+    if(2 * (this->size() + 1) > (int)m_slots.size())
+      this->grow();
+
+    uint64_t h = Bitset::hash(s, m_words);
+    size_t mask = m_slots.size() - 1;
+    size_t p = h & mask;
+    while(m_slots[p] != -1){
+      int i = m_slots[p];
+      if(m_hashes[i] == h && Bitset::equal(this->get(i), s, m_words)){
+        if(inserted) *inserted = false;
+        return i;
+      }
+      p = (p + 1) & mask;
+    }
+
+    int i = this->size();
+    m_slots[p] = i;
+    m_hashes.push_back(h);
+    m_sets.insert(m_sets.end(), s, s + m_words);
+    if(inserted) *inserted = true;
+    return i;
+  }
+
+  void clear(){
+    m_sets.clear();
+    m_hashes.clear();
+    m_slots.clear();
+  }
+};
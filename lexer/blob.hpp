@@ -0,0 +1,50 @@
+#pragma once
+
+#include <ostream>
+#include <vector>
+#include <cstring>
+#include <cstddef>
+
+// raw, host-endian serialization of the compiled automata. blobs are only
+// meant to be read back by the same build that wrote them.
+
+template<typename T>
+inline void blob_write(std::ostream & out, const T & x){
+  out.write((const char *)&x, sizeof(T));
+}
+
+template<typename T>
+inline void blob_write(std::ostream & out, const std::vector<T> & v){
+  blob_write(out, (int32_t)v.size());
+  if(!v.empty())
+    out.write((const char *)v.data(), v.size() * sizeof(T));
+}
+
+struct BlobReader{
+  const char * p;
+  const char * end;
+
+  BlobReader(const char * p, size_t n) : p(p), end(p + n) {}
+
+  bool read(void * to, size_t n){
+    if((size_t)(end - p) < n)
+      return false;
+    memcpy(to, p, n);
+    p += n;
+    return true;
+  }
+
+  template<typename T>
+  bool read(T & x){
+    return read(&x, sizeof(T));
+  }
+
+  template<typename T>
+  bool read(std::vector<T> & v){
+    int32_t n;
+    if(!read(n) || n < 0 || (size_t)(end - p) < n * sizeof(T))
+      return false;
+    v.resize(n);
+    return read(v.data(), n * sizeof(T));
+  }
+};
@@ -6,6 +6,7 @@
 #include <algorithm>
 #include <utility>
 #include <iostream>
+#include <limits>
 
 #define LABEL int16_t
 #define EPSILON ((LABEL)(1<<14))
@@ -27,15 +28,25 @@ struct CharRange{
   }
 };
 
+// tags mark which lexer rule a final state accepts (lower wins)
+#define NO_TAG (-1)
+
+inline int merge_tags(int a, int b){
+  if(a == NO_TAG) return b;
+  if(b == NO_TAG) return a;
+  return std::min(a, b);
+}
+
 struct State{
   std::map<CharRange, int> t;
   bool is_final = false;
+  int tag = NO_TAG;
 
   void add_transition(CharRange range, int idx){
     t[range] = idx;
   }
 
-  decltype(t) transitions() const {
+  const decltype(t) & transitions() const {
     return t;
   }
 
@@ -57,18 +68,19 @@ struct State{
 struct NState{
   std::map<CharRange, std::set<int>> t;
   bool is_final = false;
+  int tag = NO_TAG;
 
-  std::set<int> epsilon_transitions() const {
-    if(this->t.count(EPSILON))
-      return this->t.at(EPSILON);
-    return std::set<int>();
+  const std::set<int> & epsilon_transitions() const {
+    static const std::set<int> none;
+    auto it = this->t.find(EPSILON);
+    return it != this->t.end() ? it->second : none;
   }
 
   void add_transition(CharRange range, int idx){
     t[range].insert(idx);
   }
 
-  decltype(t) transitions() const {
+  const decltype(t) & transitions() const {
     return t;
   }
 
@@ -79,7 +91,7 @@ struct NState{
   std::vector<int> next(LABEL c) const{
     std::vector<int> res;
 
-    for(const auto & p : this->transitions()){
+    for(const auto & p : this->t){
       if(p.first.in_range(c)){
         copy(p.second.begin(), p.second.end(), back_inserter(res));
       }
@@ -0,0 +1,245 @@
+#include "csr.hpp"
+#include "bitnfa.hpp"
+#include "bitset.hpp"
+#include <algorithm>
+
+int CsrAutomaton::Builder::add_state(bool is_final, int tag){
+  this->seal();
+  m_first.push_back(m_edges.size());
+  m_final.push_back(is_final);
+  m_tag.push_back(tag);
+  return m_final.size() - 1;
+}
+
+void CsrAutomaton::Builder::add_edge(CharRange range, int to){
+  m_edges.push_back({range, to});
+  m_first.back() = m_edges.size();
+}
+
+void CsrAutomaton::Builder::set_final(int i, bool is_final, int tag){
+  m_final[i] = is_final;
+  m_tag[i] = tag;
+}
+
+// sorts and dedups the edges of the last state
+void CsrAutomaton::Builder::seal(){
+  if(m_final.empty())
+    return;
+
+  int lo = m_first[m_first.size() - 2];
+  std::sort(m_edges.begin() + lo, m_edges.end());
+  m_edges.erase(std::unique(m_edges.begin() + lo, m_edges.end()),
+                m_edges.end());
+  m_first.back() = m_edges.size();
+}
+
+CsrAutomaton CsrAutomaton::Builder::build(std::vector<CharRange> alphabet){
+  this->seal();
+
+  CsrAutomaton res;
+  res.m_first.swap(m_first);
+  res.m_edges.swap(m_edges);
+  res.m_final.swap(m_final);
+  res.m_tag.swap(m_tag);
+  res.m_alphabet.swap(alphabet);
+
+  m_first.assign(1, 0);
+  return res;
+}
+
+CsrAutomaton::CsrAutomaton(const NFA & nfa){
+  m_first.reserve(nfa.size() + 1);
+  m_first.push_back(0);
+
+  for(const NState & s : nfa.states()){
+    for(const auto & p : s.transitions()){
+      for(int x : p.second)
+        m_edges.push_back({p.first, x});
+    }
+    m_first.push_back(m_edges.size());
+    m_final.push_back(s.is_final);
+    m_tag.push_back(s.tag);
+  }
+}
+
+CsrAutomaton::CsrAutomaton(const DFA & dfa){
+  m_first.reserve(dfa.size() + 1);
+  m_first.push_back(0);
+
+  for(const State & s : dfa.states()){
+    for(const auto & p : s.transitions())
+      m_edges.push_back({p.first, p.second});
+    m_first.push_back(m_edges.size());
+    m_final.push_back(s.is_final);
+    m_tag.push_back(s.tag);
+  }
+
+  m_alphabet = dfa.alphabet();
+}
+
+// every state takes the non-epsilon moves, acceptance and tags of the
+// states it reaches through epsilon moves
+CsrAutomaton CsrAutomaton::epsilon_closure() const{
+  Builder res;
+  std::vector<int> seen(this->size(), -1), stack, closure;
+
+  for(int i = 0; i < this->size(); i++){
+    closure.clear();
+    seen[i] = i;
+    stack.push_back(i);
+
+    while(!stack.empty()){
+      int cur = stack.back();
+      stack.pop_back();
+      closure.push_back(cur);
+
+      for(const Edge * e = this->edges_begin(cur); e != this->edges_end(cur); e++){
+        if(e->range.in_range(EPSILON) && seen[e->to] != i){
+          seen[e->to] = i;
+          stack.push_back(e->to);
+        }
+      }
+    }
+
+    bool is_final = false;
+    int tag = NO_TAG;
+    res.add_state();
+    for(int x : closure){
+      is_final |= this->is_final(x);
+      tag = merge_tags(tag, this->tag(x));
+
+      for(const Edge * e = this->edges_begin(x); e != this->edges_end(x); e++){
+        if(!e->range.in_range(EPSILON))
+          res.add_edge(e->range, e->to);
+      }
+    }
+    res.set_final(i, is_final, tag);
+  }
+
+  return res.build();
+}
+
+// subset construction over bitsets of epsilon-closed states, interned in
+// an open addressing table. DFA states are numbered in discovery order,
+// so the table doubles as the worklist.
+CsrAutomaton CsrAutomaton::powerset(int limit) const{
+  BitNFA bits(*this);
+  int w = bits.words(), k = bits.symbols();
+  // raw targets are NFA states, closed sets only their positions
+  int rw = Bitset::words(bits.states());
+
+  Builder res;
+  StateSetTable sets(w);
+  std::vector<BitWord> cur(w), next(w), raw(k * rw);
+  std::vector<char> hit(k, false);
+  std::vector<int> touched;
+
+  bits.initial(cur.data());
+  sets.insert(cur.data());
+
+  for(int idx = 0; idx < sets.size(); idx++){
+    cur.assign(sets.get(idx), sets.get(idx) + w);
+    res.add_state(bits.is_final(cur.data()), bits.tag(cur.data()));
+
+    // raw targets per symbol, closed only once per symbol afterwards
+    touched.clear();
+    Bitset::for_each(cur.data(), w, [&](int i){
+      for(const BitNFA::Move & mv : bits.moves(i)){
+        for(int a = mv.lo; a < mv.hi; a++){
+          if(!hit[a]){
+            hit[a] = true;
+            touched.push_back(a);
+            Bitset::clear(&raw[a * rw], rw);
+          }
+          Bitset::set(&raw[a * rw], mv.to);
+        }
+      }
+    });
+
+    sort(touched.begin(), touched.end());
+    for(int a : touched){
+      hit[a] = false;
+      Bitset::clear(next.data(), w);
+      Bitset::for_each(&raw[a * rw], rw, [&](int t){
+        Bitset::unite(next.data(), bits.closure(t), w);
+      });
+
+      res.add_edge(bits.alphabet()[a], sets.insert(next.data()));
+    }
+
+    if(limit >= 0 && sets.size() > limit)
+      return CsrAutomaton();
+  }
+
+  return res.build(bits.alphabet());
+}
+
+// a new start state (0) leads by epsilon moves to the old finals, which
+// are shifted by one; the old start becomes the only final state
+CsrAutomaton CsrAutomaton::reversal() const{
+  int n = this->size() + 1;
+
+  // edges are bucketed by their new source, the old target
+  std::vector<int> first(n + 1, 0);
+  for(int i = 0; i < this->size(); i++){
+    if(this->is_final(i))
+      first[1]++;
+  }
+  for(const Edge & e : m_edges)
+    first[e.to + 2]++;
+  for(int i = 0; i < n; i++)
+    first[i+1] += first[i];
+
+  std::vector<Edge> edges(first[n], Edge{CharRange(0), 0});
+  std::vector<int> fill(first.begin(), first.end() - 1);
+  for(int i = 0; i < this->size(); i++){
+    if(this->is_final(i))
+      edges[fill[0]++] = {CharRange(EPSILON), i + 1};
+    for(const Edge * e = this->edges_begin(i); e != this->edges_end(i); e++)
+      edges[fill[e->to + 1]++] = {e->range, i + 1};
+  }
+
+  CsrAutomaton res;
+  res.m_first.swap(first);
+  res.m_edges.swap(edges);
+  res.m_final.assign(n, false);
+  res.m_tag.assign(n, NO_TAG);
+  if(n > 1)
+    res.m_final[1] = true;
+
+  for(int i = 0; i < n; i++)
+    std::sort(res.m_edges.begin() + res.m_first[i],
+              res.m_edges.begin() + res.m_first[i+1]);
+  return res;
+}
+
+NFA CsrAutomaton::to_nfa() const{
+  NFA res;
+  res.states().reserve(this->size());
+  for(int i = 0; i < this->size(); i++){
+    NState & s = res.state(res.add_state());
+    s.is_final = this->is_final(i);
+    s.tag = this->tag(i);
+
+    for(const Edge * e = this->edges_begin(i); e != this->edges_end(i); e++){
+      std::set<int> & to = s.t[e->range];
+      to.insert(to.end(), e->to);
+    }
+  }
+  return res;
+}
+
+DFA CsrAutomaton::to_dfa() const{
+  DFA res;
+  res.states().reserve(this->size());
+  for(int i = 0; i < this->size(); i++){
+    State & s = res.state(res.add_state());
+    s.is_final = this->is_final(i);
+    s.tag = this->tag(i);
+
+    for(const Edge * e = this->edges_begin(i); e != this->edges_end(i); e++)
+      s.t.emplace_hint(s.t.end(), e->range, e->to);
+  }
+  res.set_alphabet(m_alphabet);
+  return res;
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+#include "common.hpp"
+#include "nfa.hpp"
+#include "dfa.hpp"
+#include <vector>
+
+// An immutable automaton in compressed sparse row form: the edges leaving
+// state i are edges()[first(i) .. first(i+1)), sorted by range and then
+// target, with EPSILON ranges for epsilon moves. State 0 is the start.
+class CsrAutomaton{
+public:
+  struct Edge{
+    CharRange range;
+    int to;
+
+    bool operator<(const Edge & rhs) const {
+      if(range.left != rhs.range.left || range.right != rhs.range.right)
+        return range < rhs.range;
+      return to < rhs.to;
+    }
+
+    bool operator==(const Edge & rhs) const {
+      return range.left == rhs.range.left && range.right == rhs.range.right
+        && to == rhs.to;
+    }
+  };
+
+  // appends states one at a time, each followed by its edges
+  class Builder{
+  private:
+    std::vector<int> m_first;
+    std::vector<Edge> m_edges;
+    std::vector<char> m_final;
+    std::vector<int> m_tag;
+
+    void seal();
+
+  public:
+    Builder() : m_first(1, 0) {}
+
+    int add_state(bool is_final = false, int tag = NO_TAG);
+    void add_edge(CharRange range, int to);
+    void set_final(int i, bool is_final, int tag);
+
+    CsrAutomaton build(std::vector<CharRange> alphabet = {});
+  };
+
+private:
+  std::vector<int> m_first; // [size() + 1]
+  std::vector<Edge> m_edges;
+  std::vector<char> m_final;
+  std::vector<int> m_tag;
+
+  // the disjoint input ranges, when known (deterministic results)
+  std::vector<CharRange> m_alphabet;
+
+public:
+  CsrAutomaton() : m_first(1, 0) {}
+  explicit CsrAutomaton(const NFA &);
+  explicit CsrAutomaton(const DFA &);
+
+  int size() const { return m_final.size(); }
+  int first(int i) const { return m_first[i]; }
+  const Edge * edges_begin(int i) const { return m_edges.data() + m_first[i]; }
+  const Edge * edges_end(int i) const { return m_edges.data() + m_first[i+1]; }
+  int edge_count() const { return m_edges.size(); }
+
+  bool is_final(int i) const { return m_final[i]; }
+  int tag(int i) const { return m_tag[i]; }
+  const std::vector<CharRange> & alphabet() const { return m_alphabet; }
+
+  CsrAutomaton epsilon_closure() const;
+  // with a limit, an empty automaton if the DFA would need more states
+  CsrAutomaton powerset(int limit = -1) const;
+  CsrAutomaton reversal() const;
+
+  NFA to_nfa() const;
+  DFA to_dfa() const;
+};
@@ -1,4 +1,8 @@
 #include "dfa.hpp"
+#include "csr.hpp"
+#include <map>
+#include <cstring>
+#include <vector>
 
 int DFA::size() const{
   return this->m_states.size();
@@ -21,63 +25,440 @@ State & DFA::state(int i = 0){
 }
 
 int DFA::add_state(){
+  this->m_table.clear();
+  this->m_final.clear();
+  this->m_tag.clear();
   this->m_states.emplace_back();
   return this->size()-1;
 }
 
-bool DFA::run(std::string s) const{
+const std::vector<CharRange> & DFA::alphabet() const{
+  return this->m_alphabet;
+}
+
+void DFA::set_alphabet(const std::vector<CharRange> & v){
+  this->m_alphabet = v;
+}
+
+void DFA::compile(){
+  int n = this->size();
+
+  if(this->m_alphabet.empty()){
+    std::vector<CharRange> input_symbols;
+    for(const State & s : this->states()){
+      for(const auto & p : s.transitions())
+        input_symbols.push_back(p.first);
+    }
+    this->m_alphabet = get_disjoint_ranges(input_symbols);
+  }
+
+  // bytes are looked up the way step(char) always did, so they fall into
+  // the alphabet range holding (char)b; bytes outside it share class 0.
+  // ranges whose columns are identical are merged as well.
+  std::vector<std::vector<int32_t>> columns(1, std::vector<int32_t>(n, -1));
+  std::map<std::vector<int32_t>, int> column_ids;
+  std::vector<int> range_class(this->m_alphabet.size(), -1);
+  std::vector<int> byte_class(DFA_BYTES, 0);
+  column_ids[columns[0]] = 0;
+
+  for(int b = 0; b < DFA_BYTES; b++){
+    LABEL c = (char)b;
+    auto it = upper_bound(this->m_alphabet.begin(), this->m_alphabet.end(),
+                          CharRange(c, std::numeric_limits<LABEL>::max()));
+
+    if(it == this->m_alphabet.begin() || !(--it)->in_range(c))
+      continue;
+
+    int & cls = range_class[it - this->m_alphabet.begin()];
+    if(cls == -1){
+      std::vector<int32_t> col(n);
+      for(int i = 0; i < n; i++)
+        col[i] = this->state(i).next(it->left);
+
+      if(!column_ids.count(col)){
+        int nw = columns.size();
+        column_ids[col] = nw;
+        columns.push_back(col);
+      }
+      cls = column_ids[col];
+    }
+
+    byte_class[b] = cls;
+  }
+
+  // 256 live columns leave class 0 to no byte, and would not fit the
+  // byte map with it
+  int first = columns.size() > DFA_BYTES ? 1 : 0;
+  for(int b = 0; b < DFA_BYTES; b++)
+    this->m_classes[b] = byte_class[b] - first;
+  columns.erase(columns.begin(), columns.begin() + first);
+
+  this->m_nclasses = columns.size();
+  this->m_table.assign(n * this->m_nclasses, -1);
+  this->m_final.assign(n, false);
+  this->m_tag.assign(n, NO_TAG);
+
+  for(int i = 0; i < n; i++){
+    const State & st = this->state(i);
+    this->m_final[i] = st.is_final;
+    this->m_tag[i] = st.tag;
+
+    for(int k = 0; k < this->m_nclasses; k++)
+      this->m_table[i * this->m_nclasses + k] = columns[k][i];
+  }
+}
+
+// bytes are walked as the chars step() sees, so every run of chars with
+// the same target becomes one range
+void DFA::decompile(){
+  int n = this->compiled_size();
+  this->m_states.assign(n, State());
+
+  std::vector<CharRange> alphabet;
+  for(int i = 0; i < n; i++){
+    State & st = this->m_states[i];
+    st.is_final = this->m_final[i];
+    st.tag = this->m_tag[i];
+
+    int c = std::numeric_limits<char>::min();
+    while(c <= std::numeric_limits<char>::max()){
+      int to = this->next(i, (char)c), last = c;
+      while(last < std::numeric_limits<char>::max()
+            && this->next(i, (char)(last + 1)) == to)
+        last++;
+
+      if(to != -1){
+        st.add_transition(CharRange(c, last), to);
+        alphabet.push_back(CharRange(c, last));
+      }
+      c = last + 1;
+    }
+  }
+
+  this->m_alphabet = get_disjoint_ranges(alphabet);
+}
+
+bool DFA::compiled() const{
+  return !this->m_table.empty();
+}
+
+int DFA::classes() const{
+  return this->m_nclasses;
+}
+
+int DFA::compiled_size() const{
+  return this->m_final.size();
+}
+
+void DFA::save(std::ostream & out) const{
+  blob_write(out, (int32_t)this->m_nclasses);
+  out.write((const char *)this->m_classes, DFA_BYTES);
+  blob_write(out, this->m_table);
+  blob_write(out, this->m_final);
+  blob_write(out, this->m_tag);
+}
+
+void DFA::load(int states, int classes, const uint8_t * class_map,
+               const int32_t * table, const char * final, const int * tag){
+  this->m_states.clear();
+  this->m_alphabet.clear();
+  this->m_nclasses = classes;
+  memcpy(this->m_classes, class_map, DFA_BYTES);
+  this->m_table.assign(table, table + states * classes);
+  this->m_final.assign(final, final + states);
+  this->m_tag.assign(tag, tag + states);
+}
+
+bool DFA::load(BlobReader & in){
+  int32_t nclasses;
+  if(!in.read(nclasses) || nclasses <= 0 || nclasses > DFA_BYTES)
+    return false;
+
+  this->m_states.clear();
+  this->m_alphabet.clear();
+  this->m_nclasses = nclasses;
+  if(!in.read(this->m_classes, DFA_BYTES) || !in.read(this->m_table)
+      || !in.read(this->m_final) || !in.read(this->m_tag))
+    return false;
+
+  int n = this->m_final.size();
+  if((int)this->m_table.size() != n * nclasses || (int)this->m_tag.size() != n)
+    return false;
+
+  for(int i = 0; i < DFA_BYTES; i++)
+    if(this->m_classes[i] >= nclasses)
+      return false;
+
+  for(int32_t to : this->m_table)
+    if(to < -1 || to >= n)
+      return false;
+
+  return n > 0;
+}
+
+bool DFA::run(const std::string & s) const{
+  return this->run(s.data(), s.size());
+}
+
+bool DFA::run(const char * s, size_t n) const{
   int cur = 0;
-  for(char c : s){
-    int nxt = this->state(cur).next(c);
+  for(size_t i = 0; i < n; i++){
+    int nxt = this->next(cur, s[i]);
     if(nxt == -1)
       return false;
     cur = nxt;
   }
 
-  return this->state(cur).is_final;
+  return this->is_final(cur);
 }
 
-void DFA::reset(){
-  this->m_cur = 0;
-}
+void DFA::run_batch(const char * data, const size_t * begin,
+                    const size_t * end, int n, char * results,
+                    int lanes) const{
+  if(!this->compiled()){
+    for(int i = 0; i < n; i++)
+      results[i] = this->run(data + begin[i], end[i] - begin[i]);
+    return;
+  }
+
+  struct Lane{
+    const char * p;
+    const char * end;
+    int cur;
+    int idx;
+  } lane[DFA_BATCH_LANES];
 
-int DFA::step(char c){
-  if(this->m_cur == -1)
-    return -1;
+  const int32_t * table = this->m_table.data();
+  const uint8_t * classes = this->m_classes;
+  const char * final = this->m_final.data();
+  int k = this->m_nclasses;
 
-  int nxt = this->state(this->m_cur).next(c);
-  this->m_cur = nxt;
-  if(nxt == -1)
-    return -1;
+  lanes = std::max(1, std::min(lanes, DFA_BATCH_LANES));
+  int active = 0, taken = 0;
+  while(active < lanes && taken < n){
+    lane[active] = {data + begin[taken], data + end[taken], 0, taken};
+    active++, taken++;
+  }
 
-  if(this->state(nxt).is_final)
-    return 1;
+  // a finished lane picks up the next string, or is dropped
+  while(active){
+    for(int l = 0; l < active; l++){
+      Lane & ln = lane[l];
+      if(ln.p != ln.end && ln.cur != -1){
+        ln.cur = table[ln.cur * k + classes[(unsigned char)*ln.p++]];
+        continue;
+      }
 
-  return 0;
+      results[ln.idx] = ln.cur != -1 && final[ln.cur];
+      if(taken < n){
+        ln = {data + begin[taken], data + end[taken], 0, taken};
+        taken++;
+      } else {
+        ln = lane[--active];
+        l--;
+      }
+    }
+  }
 }
 
 NFA DFA::reversal() const {
-  NFA res;
-  res.add_state();
+  return CsrAutomaton(*this).reversal().to_nfa();
+}
 
-  for(int i = 0; i < this->size(); i++)
-    res.add_state();
+DFA DFA::minimized(MinimizeMethod method) const {
+  if(method == MINIMIZE_BRZOZOWSKI)
+    return this->brzozowski();
+  return this->hopcroft();
+}
 
-  res.state(1).is_final = true;
+// stays in CSR form between the passes
+DFA DFA::brzozowski() const {
+  return CsrAutomaton(*this).reversal().powerset()
+    .reversal().powerset().to_dfa();
+}
 
+NFA DFA::to_nfa() const {
+  NFA res;
   for(int i = 0; i < this->size(); i++){
-    const State & ns = this->state(i);
-    if(ns.is_final)
-      res.state(0).add_transition(EPSILON, i+1);
+    int nw = res.add_state();
+    res.state(nw).is_final = this->state(i).is_final;
+    res.state(nw).tag = this->state(i).tag;
+  }
 
-    for(const auto & p : ns.transitions()){
-      res.state(p.second+1).add_transition(p.first, i+1);
-    }
+  for(int i = 0; i < this->size(); i++){
+    for(const auto & p : this->state(i).transitions())
+      res.state(i).add_transition(p.first, p.second);
   }
 
   return res;
 }
 
-DFA DFA::minimized() const {
-  return this->reversal().powerset().reversal().powerset();
+// Hopcroft's partition refinement over the DFA completed with a sink
+// state. The initial partition groups states by acceptance and tag, so
+// final states of different lexer rules are never merged.
+DFA DFA::hopcroft() const {
+  std::vector<CharRange> input_symbols = this->m_alphabet;
+  if(input_symbols.empty()){
+    for(const State & s : this->states()){
+      for(const auto & p : s.transitions())
+        input_symbols.push_back(p.first);
+    }
+    input_symbols = get_disjoint_ranges(input_symbols);
+  }
+
+  int n = this->size() + 1, sink = n - 1;
+  int k = input_symbols.size();
+
+  // inverse transitions per symbol, in CSR form: pred[a][first..first+cnt)
+  std::vector<int> delta(n * k, sink);
+  for(int i = 0; i < sink; i++){
+    for(int a = 0; a < k; a++){
+      int to = this->state(i).next(input_symbols[a].left);
+      if(to != -1)
+        delta[i * k + a] = to;
+    }
+  }
+
+  std::vector<int> pred_first(k * n + 1, 0), pred(n * k);
+  for(int i = 0; i < n; i++)
+    for(int a = 0; a < k; a++)
+      pred_first[a * n + delta[i * k + a] + 1]++;
+  for(int i = 0; i < k * n; i++)
+    pred_first[i+1] += pred_first[i];
+  {
+    std::vector<int> fill(pred_first.begin(), pred_first.end() - 1);
+    for(int i = 0; i < n; i++)
+      for(int a = 0; a < k; a++)
+        pred[fill[a * n + delta[i * k + a]]++] = i;
+  }
+
+  // refinable partition: elems[first[b]..last[b]) are the states of block b
+  std::vector<int> elems(n), loc(n), blk(n);
+  std::vector<int> first, last, marked;
+
+  {
+    std::map<std::pair<bool, int>, std::vector<int>> groups;
+    for(int i = 0; i < n; i++){
+      if(i == sink)
+        groups[std::make_pair(false, NO_TAG)].push_back(i);
+      else
+        groups[std::make_pair(this->state(i).is_final,
+                              this->state(i).tag)].push_back(i);
+    }
+
+    int pos = 0;
+    for(const auto & g : groups){
+      int b = first.size();
+      first.push_back(pos);
+      for(int x : g.second){
+        elems[pos] = x;
+        loc[x] = pos++;
+        blk[x] = b;
+      }
+      last.push_back(pos);
+      marked.push_back(0);
+    }
+  }
+
+  std::vector<std::pair<int, int>> work;
+  std::vector<char> in_work;
+  auto push_work = [&](int b, int a){
+    if((int)in_work.size() <= b * k + a)
+      in_work.resize((b + 1) * k, false);
+    if(!in_work[b * k + a]){
+      in_work[b * k + a] = true;
+      work.push_back(std::make_pair(b, a));
+    }
+  };
+
+  for(int b = 0; b < (int)first.size(); b++)
+    for(int a = 0; a < k; a++)
+      push_work(b, a);
+
+  std::vector<int> splitter, touched;
+  while(!work.empty()){
+    int sb = work.back().first, a = work.back().second;
+    work.pop_back();
+    in_work[sb * k + a] = false;
+
+    splitter.assign(elems.begin() + first[sb], elems.begin() + last[sb]);
+
+    // move every predecessor to the front of its block
+    touched.clear();
+    for(int t : splitter){
+      for(int j = pred_first[a * n + t]; j < pred_first[a * n + t + 1]; j++){
+        int x = pred[j], b = blk[x];
+        int m = first[b] + marked[b];
+        if(loc[x] < m)
+          continue;
+
+        if(!marked[b])
+          touched.push_back(b);
+
+        int y = elems[m];
+        std::swap(elems[loc[x]], elems[m]);
+        loc[y] = loc[x];
+        loc[x] = m;
+        marked[b]++;
+      }
+    }
+
+    for(int b : touched){
+      int m = marked[b];
+      marked[b] = 0;
+      if(m == last[b] - first[b])
+        continue;
+
+      // the marked prefix becomes a new block
+      int nb = first.size();
+      first.push_back(first[b]);
+      last.push_back(first[b] + m);
+      marked.push_back(0);
+      first[b] += m;
+
+      for(int j = first[nb]; j < last[nb]; j++)
+        blk[elems[j]] = nb;
+
+      int small = (last[nb] - first[nb] <= last[b] - first[b]) ? nb : b;
+      for(int c = 0; c < k; c++){
+        if((int)in_work.size() > b * k + c && in_work[b * k + c])
+          push_work(nb, c);
+        else
+          push_work(small, c);
+      }
+    }
+  }
+
+  // blocks equivalent to the sink are dead and get dropped; the block of
+  // the initial state stays at 0
+  int blocks = first.size();
+  std::vector<int> order(blocks, -1);
+  std::vector<int> repr;
+  order[blk[0]] = 0;
+  repr.push_back(0);
+  for(int i = 0; i < sink; i++){
+    if(order[blk[i]] == -1 && blk[i] != blk[sink]){
+      order[blk[i]] = repr.size();
+      repr.push_back(i);
+    }
+  }
+
+  DFA res;
+  res.set_alphabet(input_symbols);
+  for(int i = 0; i < (int)repr.size(); i++){
+    int nw = res.add_state();
+    res.state(nw).is_final = this->state(repr[i]).is_final;
+    res.state(nw).tag = this->state(repr[i]).tag;
+  }
+
+  for(int i = 0; i < (int)repr.size(); i++){
+    for(int a = 0; a < k; a++){
+      int to = delta[repr[i] * k + a];
+      if(blk[to] == blk[sink])
+        continue;
+      res.state(i).add_transition(input_symbols[a], order[blk[to]]);
+    }
+  }
+
+  return res;
 }
@@ -2,7 +2,18 @@
 
 #include "common.hpp"
 #include "nfa.hpp"
+#include "blob.hpp"
 #include <iostream>
+#include <vector>
+#include <cstdint>
+
+#define DFA_BYTES 256
+#define DFA_BATCH_LANES 4
+
+enum MinimizeMethod {
+  MINIMIZE_BRZOZOWSKI, // double reversal, drops tags
+  MINIMIZE_HOPCROFT    // partition refinement, keeps tags apart
+};
 
 class NFA;
 class DFA {
@@ -10,6 +21,16 @@ private:
   std::vector<State> m_states;
   int m_cur = 0;
 
+  // disjoint input ranges, as computed by the powerset construction
+  std::vector<CharRange> m_alphabet;
+
+  // compiled form, built by compile() from the map-based states
+  uint8_t m_classes[DFA_BYTES]; // byte -> equivalence class
+  int m_nclasses = 0;
+  std::vector<int32_t> m_table; // [state * m_nclasses + class]
+  std::vector<char> m_final;
+  std::vector<int> m_tag;
+
 public:
   int size() const;
 
@@ -21,6 +42,9 @@ public:
 
   int add_state();
 
+  const std::vector<CharRange> & alphabet() const;
+  void set_alphabet(const std::vector<CharRange> &);
+
   void dump() const{
     std::cerr<< this->size() << std::endl;
     for(int i = 0; i < this->size(); i++){
@@ -38,10 +62,70 @@ public:
     std::cerr << std::endl;
   }
 
-  bool run(std::string s) const;
-  void reset();
-  int step(char c);
+  void compile();
+  bool compiled() const;
+  int classes() const;
+  int compiled_size() const;
+
+  // a loaded DFA only has its compiled form, no states
+  void save(std::ostream &) const;
+  bool load(BlobReader &);
+  void load(int states, int classes, const uint8_t * class_map,
+            const int32_t * table, const char * final, const int * tag);
+
+  // rebuilds map-based states from the compiled form, e.g. after load()
+  void decompile();
+
+  const uint8_t * class_map() const { return this->m_classes; }
+  const int32_t * table() const { return this->m_table.data(); }
+  const char * finals() const { return this->m_final.data(); }
+  const int * tags() const { return this->m_tag.data(); }
+
+  int next(int cur, char c) const {
+    if(!this->m_table.empty())
+      return this->m_table[cur * this->m_nclasses
+                           + this->m_classes[(unsigned char)c]];
+    return this->state(cur).next(c);
+  }
+
+  bool is_final(int i) const {
+    if(!this->m_final.empty())
+      return this->m_final[i];
+    return this->state(i).is_final;
+  }
+
+  int tag(int i) const {
+    if(!this->m_tag.empty())
+      return this->m_tag[i];
+    return this->state(i).tag;
+  }
+
+  bool run(const std::string & s) const;
+  bool run(const char * s, size_t n) const;
+
+  // matches n strings, string i being data[begin[i], end[i]), setting
+  // results[i] to whether it is accepted. a compiled DFA walks up to
+  // lanes strings side by side, hiding the latency of table lookups.
+  void run_batch(const char * data, const size_t * begin, const size_t * end,
+                 int n, char * results, int lanes = DFA_BATCH_LANES) const;
+  // called per input byte by the lexer, so kept inline like next()
+  void reset() { this->m_cur = 0; }
+  int step(char c){
+    if(this->m_cur == -1)
+      return -1;
+
+    int nxt = this->next(this->m_cur, c);
+    this->m_cur = nxt;
+    if(nxt == -1)
+      return -1;
+
+    return this->is_final(nxt) ? 1 : 0;
+  }
+  int current() const { return this->m_cur; }
 
   NFA reversal() const;
-  DFA minimized() const;
+  NFA to_nfa() const;
+  DFA minimized(MinimizeMethod = MINIMIZE_HOPCROFT) const;
+  DFA brzozowski() const;
+  DFA hopcroft() const;
 };
@@ -0,0 +1,109 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+
+// Reserved words recognized after the fact among the tokens of another
+// rule (identifiers), through a perfect hash found by build(): every
+// word gets its own slot, so a lookup is one hash and one compare.
+class KeywordTable {
+private:
+  uint32_t m_seed = 0;
+  std::vector<std::string> m_words; // per slot, empty when unused
+  std::vector<int16_t> m_types;
+  int m_min = 1, m_max = 0;
+
+  static uint32_t hash(const char * s, int n, uint32_t seed){
+    uint32_t h = 2166136261u ^ seed;
+    for(int i = 0; i < n; i++){
+      h ^= (unsigned char)s[i];
+      h *= 16777619u;
+    }
+    return h ^ (h >> 15);
+  }
+
+  void fit(){
+    m_min = 1 << 30;
+    m_max = 0;
+    for(const std::string & w : m_words){
+      if(w.empty())
+        continue;
+      m_min = std::min(m_min, (int)w.size());
+      m_max = std::max(m_max, (int)w.size());
+    }
+  }
+
+public:
+  bool empty() const {
+    return m_max == 0;
+  }
+
+  uint32_t seed() const { return m_seed; }
+  int slots() const { return m_words.size(); }
+  const std::string & word(int i) const { return m_words[i]; }
+  int16_t type(int i) const { return m_types[i]; }
+
+  // searches a seed placing every word in its own slot, with at least
+  // twice as many slots as words
+  void build(const std::vector<std::string> & words,
+             const std::vector<int16_t> & types){
+    m_words.clear();
+    m_types.clear();
+    m_min = 1;
+    m_max = 0;
+    if(words.empty())
+      return;
+
+    int slots = 1;
+    while(slots < 2 * (int)words.size())
+      slots <<= 1;
+
+    for(uint32_t seed = 0;; seed++){
+      if(seed == 4096){
+        seed = 0;
+        slots <<= 1;
+      }
+
+      std::vector<std::string> table(slots);
+      std::vector<int16_t> table_types(slots, 0);
+      bool ok = true;
+      for(int i = 0; i < (int)words.size() && ok; i++){
+        uint32_t p = hash(words[i].data(), words[i].size(), seed) & (slots-1);
+        ok = table[p].empty();
+        table[p] = words[i];
+        table_types[p] = types[i];
+      }
+
+      if(ok){
+        m_seed = seed;
+        m_words.swap(table);
+        m_types.swap(table_types);
+        this->fit();
+        return;
+      }
+    }
+  }
+
+  void load(uint32_t seed, int slots, const char * const * words,
+            const int16_t * types){
+    m_seed = seed;
+    m_words.assign(words, words + slots);
+    m_types.assign(types, types + slots);
+    this->fit();
+  }
+
+  // the type of the keyword s, or -1 when it is not one
+  int find(const char * s, int n) const {
+    if(n < m_min || n > m_max)
+      return -1;
+
+    uint32_t p = hash(s, n, m_seed) & (m_words.size() - 1);
+    const std::string & w = m_words[p];
+    if((int)w.size() != n || memcmp(w.data(), s, n))
+      return -1;
+    return m_types[p];
+  }
+};
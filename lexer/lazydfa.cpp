@@ -0,0 +1,80 @@
+#include "lazydfa.hpp"
+
+LazyDFA::LazyDFA(const NFA & nfa, int limit)
+  : m_nfa(nfa), m_words(m_nfa.words()), m_symbols(m_nfa.symbols()),
+    m_limit(std::max(limit, 2)), m_sets(m_nfa.words()) {
+  for(int b = 0; b < 256; b++)
+    m_symbol_of[b] = m_nfa.symbol((char)b);
+
+  m_buf.resize(m_words);
+  this->flush();
+  m_flushes = 0;
+}
+
+// empties the cache, keeping only the start state (index 0)
+void LazyDFA::flush() const{
+  m_sets.clear();
+  m_next.clear();
+  m_final.clear();
+  m_flushes++;
+
+  std::vector<BitWord> start(m_words);
+  m_nfa.initial(start.data());
+  this->add(start.data());
+}
+
+int LazyDFA::add(const BitWord * s) const{
+  bool inserted;
+  int i = m_sets.insert(s, &inserted);
+  if(inserted){
+    m_next.resize(m_next.size() + m_symbols, LAZY_UNKNOWN);
+    m_final.push_back(m_nfa.is_final(s));
+  }
+  return i;
+}
+
+// the state reached from state on symbol, -1 when it is dead. this may
+// flush the cache, invalidating every other state index.
+int LazyDFA::target(int state, int symbol) const{
+  m_nfa.step(m_sets.get(state), symbol, m_buf.data());
+  if(Bitset::empty(m_buf.data(), m_words))
+    return m_next[state * m_symbols + symbol] = -1;
+
+  int before = m_sets.size();
+  int to = m_sets.insert(m_buf.data());
+  if(to < before)
+    return m_next[state * m_symbols + symbol] = to;
+
+  // a new state, which does not fit: start over with it
+  if(before >= m_limit){
+    std::vector<BitWord> next(m_buf);
+    this->flush();
+    return this->add(next.data());
+  }
+
+  m_next.resize(m_next.size() + m_symbols, LAZY_UNKNOWN);
+  m_final.push_back(m_nfa.is_final(m_buf.data()));
+  return m_next[state * m_symbols + symbol] = to;
+}
+
+bool LazyDFA::run(const std::string & s) const{
+  return this->run(s.data(), s.size());
+}
+
+bool LazyDFA::run(const char * s, size_t n) const{
+  int cur = 0;
+  for(size_t i = 0; i < n; i++){
+    int a = m_symbol_of[(unsigned char)s[i]];
+    if(a < 0)
+      return false;
+
+    int nxt = m_next[cur * m_symbols + a];
+    if(nxt == LAZY_UNKNOWN)
+      nxt = this->target(cur, a);
+    if(nxt == -1)
+      return false;
+    cur = nxt;
+  }
+
+  return m_final[cur];
+}
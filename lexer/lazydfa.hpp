@@ -0,0 +1,43 @@
+#pragma once
+
+#include "common.hpp"
+#include "bitset.hpp"
+#include "bitnfa.hpp"
+#include "nfa.hpp"
+#include <string>
+#include <vector>
+
+#define LAZY_DFA_STATES 4096
+#define LAZY_UNKNOWN (-2)
+
+// Determinizes an NFA while matching: DFA states are built the first
+// time the input reaches them and cached, up to a fixed number of states.
+// When the cache is full it is flushed and filling starts over, so
+// patterns with exponential DFAs only cost what the inputs actually use.
+class LazyDFA{
+private:
+  BitNFA m_nfa;
+  int m_words, m_symbols;
+  int m_symbol_of[256]; // byte -> alphabet index, or -1
+  int m_limit;
+
+  // the cache only changes what is precomputed, not what run() returns
+  mutable StateSetTable m_sets;
+  mutable std::vector<int> m_next; // [state * m_symbols], LAZY_UNKNOWN
+  mutable std::vector<char> m_final;
+  mutable std::vector<BitWord> m_buf;
+  mutable int m_flushes = 0;
+
+  int add(const BitWord *) const;
+  int target(int state, int symbol) const;
+  void flush() const;
+
+public:
+  LazyDFA(const NFA &, int limit = LAZY_DFA_STATES);
+
+  bool run(const std::string &) const;
+  bool run(const char * s, size_t n) const;
+
+  int cached() const { return m_sets.size(); }
+  int flushes() const { return m_flushes; }
+};
@@ -1,73 +1,317 @@
 #include "lexer.hpp"
+#include "regex_cache.hpp"
+#include <iterator>
+#include <stdexcept>
 
-LexerRule::LexerRule(int16_t s, std::string re){
+LexerRule::LexerRule(int16_t s, std::string re, MinimizeMethod method){
   this->name = s;
-  this->dfa = Regex(re).get_dfa();
+  this->dfa = RegexCache::global().get(re, method)->get_dfa();
 }
 
 void Lexer::add_rule(int16_t s, std::string re){
-    this->m_rules.emplace_back(s, re);
+    this->m_rules.emplace_back(s, re, this->m_method);
+    this->m_built = false;
 }
 
 void Lexer::add_hidden_rule(int16_t s, std::string re){
-    this->m_rules.emplace_back(s, re);
+    this->m_rules.emplace_back(s, re, this->m_method);
     this->m_rules.back().hidden = true;
+    this->m_built = false;
 }
 
-std::vector<Token> Lexer::run(Stream & s, bool show_hidden){
-  int sz = this->m_rules.size();
-  int consumed;
-  std::vector<int> munch(sz);
-  std::vector<Token> res;
+// tokens of rule spelling word become s instead. this keeps keywords out
+// of the DFA, they just have to match rule as well. there is a single
+// keyword table, so every keyword has to go through the same rule.
+void Lexer::add_keyword(int16_t rule, std::string word, int16_t s){
+  if(this->m_keyword_rule != LEXER_ERROR && this->m_keyword_rule != rule)
+    throw std::runtime_error("keywords already belong to another rule");
+  this->m_keyword_rule = rule;
+  this->m_keyword_words.push_back(word);
+  this->m_keyword_types.push_back(s);
+  this->m_built = false;
+}
 
-  while(s.peek() != EOF){
-    consumed = 0;
-    fill(munch.begin(), munch.end(), 0);
+// the rules' DFAs are appended one after the other behind a common
+// start state, which enters each by an epsilon move
+void Lexer::build(){
+  int total = 1;
+  for(const LexerRule & rule : this->m_rules)
+    total += rule.dfa.size();
+
+  NFA all;
+  all.states().reserve(total);
+  all.add_state();
 
-    for(LexerRule & rule : this->m_rules){
-      rule.dfa.reset();
+  for(int i = 0; i < (int)this->m_rules.size(); i++){
+    const DFA & dfa = this->m_rules[i].dfa;
+    int base = all.size();
+    if(!dfa.size())
+      continue;
+
+    all.state(0).add_transition(EPSILON, base);
+    for(int k = 0; k < dfa.size(); k++){
+      NState & st = all.state(all.add_state());
+      st.is_final = dfa.state(k).is_final;
+      st.tag = st.is_final ? i : NO_TAG;
+      for(const auto & p : dfa.state(k).transitions())
+        st.add_transition(p.first, p.second + base);
     }
+  }
+
+  // only Hopcroft keeps the rule tags apart
+  this->m_dfa = all.powerset().minimized(MINIMIZE_HOPCROFT);
+  this->m_dfa.compile();
+  this->accelerate();
+  this->m_keywords.build(this->m_keyword_words, this->m_keyword_types);
+  this->m_built = true;
+}
+
+void Lexer::accelerate(){
+  this->m_accel.assign(this->m_dfa.compiled_size(), -1);
+  this->m_skips.clear();
+
+  for(int i = 0; i < this->m_dfa.compiled_size(); i++){
+    bool skips[256];
+    int loops = 0;
+    for(int b = 0; b < 256; b++){
+      skips[b] = this->m_dfa.next(i, (char)b) == i;
+      loops += skips[b];
+    }
+
+    // the stream reads 0xff as EOF, so never skip over it
+    loops -= skips[255];
+    skips[255] = false;
+
+    ByteRanges r;
+    if(loops < 2 || !r.build(skips))
+      continue;
+
+    this->m_accel[i] = this->m_skips.size();
+    this->m_skips.push_back(r);
+  }
+}
+
+void Lexer::save(std::ostream & out){
+  if(!this->m_built)
+    this->build();
+
+  blob_write(out, (int32_t)LEXER_TABLES_MAGIC);
+  blob_write(out, (int32_t)this->m_rules.size());
+  for(const LexerRule & rule : this->m_rules){
+    blob_write(out, rule.name);
+    blob_write(out, (char)rule.hidden);
+  }
+
+  blob_write(out, this->m_keyword_rule);
+  blob_write(out, this->m_keywords.seed());
+  blob_write(out, (int32_t)this->m_keywords.slots());
+  for(int i = 0; i < this->m_keywords.slots(); i++){
+    const std::string & w = this->m_keywords.word(i);
+    blob_write(out, std::vector<char>(w.begin(), w.end()));
+    blob_write(out, this->m_keywords.type(i));
+  }
+
+  this->m_dfa.save(out);
+}
+
+bool Lexer::load(const char * data, size_t n){
+  BlobReader in(data, n);
+  int32_t magic, rules;
+  if(!in.read(magic) || magic != LEXER_TABLES_MAGIC)
+    return false;
+  if(!in.read(rules) || rules < 0)
+    return false;
+
+  std::vector<LexerRule> loaded;
+  for(int i = 0; i < rules; i++){
+    int16_t name;
+    char hidden;
+    if(!in.read(name) || !in.read(hidden))
+      return false;
+    loaded.emplace_back(name, (bool)hidden);
+  }
+
+  int16_t keyword_rule;
+  uint32_t seed;
+  int32_t slots;
+  if(!in.read(keyword_rule) || !in.read(seed) || !in.read(slots))
+    return false;
+  if(slots < 0 || (slots & (slots - 1)))
+    return false;
+
+  std::vector<std::string> words(slots);
+  std::vector<const char *> word_ptrs(slots);
+  std::vector<int16_t> types(slots);
+  for(int i = 0; i < slots; i++){
+    std::vector<char> w;
+    if(!in.read(w) || !in.read(types[i]))
+      return false;
+    words[i].assign(w.begin(), w.end());
+    word_ptrs[i] = words[i].c_str();
+  }
+
+  DFA dfa;
+  if(!dfa.load(in) || in.p != in.end)
+    return false;
+
+  // every accepting state has to name a rule, see next()
+  for(int i = 0; i < dfa.compiled_size(); i++)
+    if(dfa.is_final(i) && (dfa.tag(i) < 0 || dfa.tag(i) >= rules))
+      return false;
+
+  if(keyword_rule != LEXER_ERROR){
+    bool known = false;
+    for(const LexerRule & rule : loaded)
+      known |= rule.name == keyword_rule;
+    if(!known)
+      return false;
+  }
 
-    std::string str;
-    bool works = true;
-    std::pair<int, int> location;
+  this->m_rules.swap(loaded);
+  this->m_dfa = dfa;
+  this->accelerate();
+  this->m_keyword_rule = keyword_rule;
+  this->m_keywords.load(seed, slots, word_ptrs.data(), types.data());
+  this->m_built = true;
+  return true;
+}
+
+bool Lexer::load(std::istream & in){
+  std::string data((std::istreambuf_iterator<char>(in)),
+                   std::istreambuf_iterator<char>());
+  return this->load(data.data(), data.size());
+}
+
+LexerTables Lexer::tables(){
+  if(!this->m_built)
+    this->build();
+
+  this->m_names.clear();
+  this->m_hidden.clear();
+  for(const LexerRule & rule : this->m_rules){
+    this->m_names.push_back(rule.name);
+    this->m_hidden.push_back(rule.hidden);
+  }
+
+  this->m_keyword_ptrs.clear();
+  this->m_keyword_slot_types.clear();
+  for(int i = 0; i < this->m_keywords.slots(); i++){
+    this->m_keyword_ptrs.push_back(this->m_keywords.word(i).c_str());
+    this->m_keyword_slot_types.push_back(this->m_keywords.type(i));
+  }
+
+  LexerTables t;
+  t.rules = this->m_rules.size();
+  t.names = this->m_names.data();
+  t.hidden = this->m_hidden.data();
+  t.states = this->m_dfa.compiled_size();
+  t.classes = this->m_dfa.classes();
+  t.class_map = this->m_dfa.class_map();
+  t.next = this->m_dfa.table();
+  t.final = this->m_dfa.finals();
+  t.tag = this->m_dfa.tags();
+  t.keyword_rule = this->m_keyword_rule;
+  t.keyword_seed = this->m_keywords.seed();
+  t.keyword_slots = this->m_keywords.slots();
+  t.keyword_words = this->m_keyword_ptrs.data();
+  t.keyword_types = this->m_keyword_slot_types.data();
+  return t;
+}
+
+void Lexer::load(const LexerTables & t){
+  this->m_rules.clear();
+  for(int i = 0; i < t.rules; i++)
+    this->m_rules.emplace_back(t.names[i], (bool)t.hidden[i]);
+
+  this->m_dfa.load(t.states, t.classes, t.class_map, t.next, t.final, t.tag);
+  this->accelerate();
+  this->m_keyword_rule = t.keyword_rule;
+  this->m_keywords.load(t.keyword_seed, t.keyword_slots, t.keyword_words,
+                        t.keyword_types);
+  this->m_built = true;
+}
+
+void Lexer::intern(int16_t s){
+  if(s >= (int)this->m_interned.size())
+    this->m_interned.resize(s + 1, false);
+  this->m_interned[s] = true;
+}
+
+const SymbolTable & Lexer::symbols() const{
+  return this->m_symbols;
+}
 
-    while(works && s.peek() != EOF){
-      works = false;
-      if(!consumed)
-        location = s.location();
+SymbolTable & Lexer::symbols(){
+  return this->m_symbols;
+}
+
+// lexes the next token into tok, returning false at the end of the input.
+// on a lexical error tok is a LEXER_ERROR token and the stream is left there.
+bool Lexer::next(Stream & s, Token & tok, bool show_hidden){
+  int consumed, maxmunch, maxrule;
+
+  if(!this->m_built)
+    this->build();
+
+  while(s.peek() != EOF){
+    consumed = maxmunch = 0;
+    maxrule = -1;
+    this->m_dfa.reset();
 
+    size_t start = s.mark();
+
+    while(s.peek() != EOF){
       consumed++;
-      char c = s.get();
-      str += c;
+      int sig = this->m_dfa.step(s.get());
+      if(sig < 0)
+        break;
 
-      for(int i = 0; i < sz; i++){
-        LexerRule & rule = this->m_rules[i];
-        int sig = rule.dfa.step(c);
-        works |= sig >= 0;
+      int cur = this->m_dfa.current();
+      if(this->m_accel[cur] >= 0)
+        consumed += s.skip(this->m_skips[this->m_accel[cur]]);
 
-        if(sig > 0)
-          munch[i] = consumed;
+      if(sig > 0){
+        maxmunch = consumed;
+        maxrule = this->m_dfa.tag(cur);
       }
     }
 
-    int maxrule = max_element(munch.begin(), munch.end()) - munch.begin();
-    int maxmunch = munch[maxrule];
-
-    // std::cerr << "consumed [" << str << "]" << std::endl;
-
+    const char * text = s.data() + start;
     if(maxmunch == 0){
-      res.push_back({LEXER_ERROR, str.substr(0,1), location});
-      return res;
+      s.reset(start);
+      tok = Token(LEXER_ERROR, text, 1, s.location(start));
+      return true;
     }
 
-    for(int i = 0; i < consumed - std::max(maxmunch, 1); i++){
-      s.unget();
-      str.pop_back();
+    s.reset(start + maxmunch);
+
+    const LexerRule & rule = this->m_rules[maxrule];
+    if(show_hidden || !rule.hidden){
+      int16_t type = rule.name;
+      if(type == this->m_keyword_rule){
+        int kw = this->m_keywords.find(text, maxmunch);
+        if(kw >= 0)
+          type = kw;
+      }
+
+      tok = Token(type, text, maxmunch, s.location(start));
+      if(type >= 0 && type < (int)this->m_interned.size() && this->m_interned[type])
+        tok.symbol = this->m_symbols.intern(text, maxmunch);
+      return true;
     }
+  }
+
+  return false;
+}
+
+std::vector<Token> Lexer::run(Stream & s, bool show_hidden){
+  std::vector<Token> res;
+  Token tok;
 
-    if(maxmunch > 0 && (show_hidden || !this->m_rules[maxrule].hidden))
-      res.push_back({this->m_rules[maxrule].name, str, location});
+  while(this->next(s, tok, show_hidden)){
+    res.push_back(tok);
+    if(tok.type == LEXER_ERROR)
+      break;
   }
 
   return res;
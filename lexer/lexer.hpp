@@ -1,9 +1,12 @@
 #pragma once
 
 #define LEXER_ERROR ((int16_t)(-1))
+#define LEXER_TABLES_MAGIC 0x3258454c // "LEX2"
 
 #include "regex.hpp"
 #include "token.hpp"
+#include "symbols.hpp"
+#include "keywords.hpp"
 #include "../common/stream.hpp"
 #include <vector>
 #include <string>
@@ -14,15 +17,81 @@ struct LexerRule {
 
   bool hidden = false;
 
-  LexerRule(int16_t, std::string re);
+  LexerRule(int16_t, std::string re, MinimizeMethod = MINIMIZE_HOPCROFT);
+  LexerRule(int16_t s, bool hidden) : name(s), hidden(hidden) {}
+};
+
+// non-owning view of a compiled lexer, e.g. over generated arrays
+struct LexerTables {
+  int rules;
+  const int16_t * names;
+  const char * hidden;
+
+  int states, classes;
+  const uint8_t * class_map; // [DFA_BYTES]
+  const int32_t * next;      // [states * classes]
+  const char * final;        // [states]
+  const int * tag;           // [states]
+
+  // keywords among the tokens of keyword_rule, LEXER_ERROR for none
+  int16_t keyword_rule;
+  uint32_t keyword_seed;
+  int keyword_slots;
+  const char * const * keyword_words; // [keyword_slots]
+  const int16_t * keyword_types;      // [keyword_slots]
 };
 
 class Lexer {
 private:
   std::vector<LexerRule> m_rules;
+  MinimizeMethod m_method;
+
+  // union of every rule, final states tagged with the rule index
+  DFA m_dfa;
+  bool m_built = false;
+
+  // states looping on themselves over a byte set, skipped in one go:
+  // m_accel[state] indexes m_skips, or is -1
+  std::vector<int> m_accel;
+  std::vector<ByteRanges> m_skips;
+
+  // tokens of m_keyword_rule are looked up in m_keywords
+  int16_t m_keyword_rule = LEXER_ERROR;
+  std::vector<std::string> m_keyword_words;
+  std::vector<int16_t> m_keyword_types;
+  KeywordTable m_keywords;
+
+  // tokens whose type is flagged here get a symbol id
+  std::vector<bool> m_interned;
+  SymbolTable m_symbols;
+
+  // backing storage for tables()
+  std::vector<int16_t> m_names;
+  std::vector<char> m_hidden;
+  std::vector<const char *> m_keyword_ptrs;
+  std::vector<int16_t> m_keyword_slot_types;
+
+  void accelerate();
+
 public:
+  Lexer(MinimizeMethod method = MINIMIZE_HOPCROFT) : m_method(method) {}
 
   void add_rule(int16_t s, std::string re);
   void add_hidden_rule(int16_t, std::string re);
+  void add_keyword(int16_t rule, std::string word, int16_t s);
+  void build();
+  bool next(Stream &, Token &, bool = false);
   std::vector<Token> run(Stream &, bool = false);
+
+  void intern(int16_t s);
+  const SymbolTable & symbols() const;
+  SymbolTable & symbols();
+
+  // precompiled tables: rule names, hidden flags and the combined DFA
+  void save(std::ostream &);
+  bool load(const char *, size_t);
+  bool load(std::istream &);
+
+  LexerTables tables();
+  void load(const LexerTables &);
 };
@@ -3,11 +3,9 @@
 
 namespace RegexNFA{
 
-  NFA kleene(const NFA & a){
-
-    NFA res = a;
-    for(int i = 0; i < a.size(); i++){
-      if(a.state(i).is_final){
+  NFA kleene(NFA res){
+    for(int i = 0; i < res.size(); i++){
+      if(res.state(i).is_final){
         res.state(i).add_transition(EPSILON, 0);
         res.state(i).is_final = false;
       }
@@ -17,19 +15,20 @@ namespace RegexNFA{
     return res;
   }
 
-  NFA cat(const NFA & a, const NFA & b){
-    NFA res = a;
+  NFA cat(NFA res, const NFA & b){
     int binit = res.size();
+    res.states().reserve(binit + b.size());
 
     for(const NState & s : b.states()){
       int ni = res.add_state();
       NState & ns = res.state(ni);
 
       ns.is_final = s.is_final;
+      ns.tag = s.tag;
       for(const auto & p : s.transitions()){
-        for(int x : p.second){
-          ns.add_transition(p.first, x + binit);
-        }
+        std::set<int> & to = ns.t[p.first];
+        for(int x : p.second)
+          to.insert(to.end(), x + binit);
       }
     }
 
@@ -45,17 +44,19 @@ namespace RegexNFA{
 
   NFA unite(const NFA & a, const NFA & b){
     NFA res;
+    res.states().reserve(a.size() + b.size() + 1);
     res.add_state();
     for(const NState & s : a.states()){
       int ni = res.add_state();
       NState & ns = res.state(ni);
 
       ns.is_final = s.is_final;
+      ns.tag = s.tag;
 
-      for(auto & p : s.transitions()){
-        for(int x : p.second){
-          ns.add_transition(p.first, x + 1);
-        }
+      for(const auto & p : s.transitions()){
+        std::set<int> & to = ns.t[p.first];
+        for(int x : p.second)
+          to.insert(to.end(), x + 1);
       }
     }
 
@@ -64,11 +65,12 @@ namespace RegexNFA{
       NState & ns = res.state(ni);
 
       ns.is_final = s.is_final;
+      ns.tag = s.tag;
 
       for(const auto & p : s.transitions()){
-        for(int x : p.second){
-          ns.add_transition(p.first, x + a.size() + 1);
-        }
+        std::set<int> & to = ns.t[p.first];
+        for(int x : p.second)
+          to.insert(to.end(), x + a.size() + 1);
       }
     }
 
@@ -77,8 +79,7 @@ namespace RegexNFA{
     return res;
   }
 
-  NFA kleene_plus(const NFA & a){
-    NFA res = a;
+  NFA kleene_plus(NFA res){
     for(int i = 0; i < res.size(); i++){
       if(res.state(i).is_final){
         res.state(i).add_transition(EPSILON, 0);
@@ -88,8 +89,7 @@ namespace RegexNFA{
     return res;
   }
 
-  NFA zero_one(const NFA & a){
-    NFA res = a;
+  NFA zero_one(NFA res){
     res.state(0).is_final = true;
     return res;
   }
@@ -2,24 +2,43 @@
 
 #include "common.hpp"
 #include "nfa.hpp"
+#include "csr.hpp"
+#include "lazydfa.hpp"
+#include "thompson.hpp"
+#include <memory>
 #include <sstream>
 #include <iostream>
 #include <vector>
 
+// combinators taking an NFA by value reuse its states, so pass
+// temporaries or std::move what is no longer needed
 namespace RegexNFA{
-  NFA kleene(const NFA &);
-  NFA cat(const NFA &, const NFA &);
+  NFA kleene(NFA);
+  NFA cat(NFA, const NFA &);
   NFA unite(const NFA &, const NFA &);
-  NFA kleene_plus(const NFA &);
-  NFA zero_one(const NFA &);
+  NFA kleene_plus(NFA);
+  NFA zero_one(NFA);
   NFA from_range(const std::vector<CharRange> &);
   NFA from_range(CharRange);
 }
 
+enum RegexMode {
+  REGEX_EAGER, // powerset and minimization up front
+  REGEX_LAZY,  // DFA states built while matching, see LazyDFA
+  REGEX_AUTO   // eager while the DFA fits the lazy cache, lazy beyond
+};
+
 class Regex{
 private:
   std::istringstream in;
+  Thompson thompson;
   DFA dfa;
+  MinimizeMethod method;
+
+  // lazy mode keeps the NFA instead of the DFA
+  RegexMode mode = REGEX_EAGER;
+  NFA nfa;
+  std::unique_ptr<LazyDFA> lazy;
 
   int peek(){ return this->in.peek(); }
   int consume(char c) {
@@ -41,7 +60,7 @@ private:
     return CharRange(first, second);
   }
 
-  NFA range(){
+  Thompson::Fragment range(){
     this->consume('[');
     bool invert = false;
     if(this->peek() == '^'){
@@ -60,41 +79,39 @@ private:
     if(invert)
       v = negate_ranges(v);
 
-    return RegexNFA::from_range(v);
+    return this->thompson.atom(v);
   }
 
-  NFA base(){
-    NFA res;
+  Thompson::Fragment base(){
     if(this->peek() == '\\'){
       this->consume('\\');
-      res = RegexNFA::from_range(this->next());
+      return this->thompson.atom(this->next());
     } else if(this->peek() == '['){
-      res = this->range();
+      return this->range();
     } else if(this->peek() == '('){
       this->consume('(');
-      res = this->regex();
+      Thompson::Fragment res = this->regex();
       this->consume(')');
-    } else{
-      res = RegexNFA::from_range(this->next());
+      return res;
     }
 
-    return res;
+    return this->thompson.atom(this->next());
   }
 
-  NFA factor(){
-    NFA res = this->base();
+  Thompson::Fragment factor(){
+    Thompson::Fragment res = this->base();
     while(this->more()){
       if(this->peek() == '*'){
         this->consume('*');
-        res = RegexNFA::kleene(res);
+        res = this->thompson.kleene(std::move(res));
       }
       else if(this->peek() == '+'){
         this->consume('+');
-        res = RegexNFA::kleene_plus(res);
+        res = this->thompson.kleene_plus(std::move(res));
       }
       else if(this->peek() == '?'){
         this->consume('?');
-        res = RegexNFA::zero_one(res);
+        res = this->thompson.zero_one(std::move(res));
       }
       else
         break;
@@ -102,38 +119,96 @@ private:
     return res;
   }
 
-  NFA term(){
-    NFA res = NFA::empty_string();
+  Thompson::Fragment term(){
+    Thompson::Fragment res = this->thompson.empty();
     while(this->more() && this->peek() != ')' && this->peek() != '|'){
-      res = RegexNFA::cat(res, this->factor());
+      Thompson::Fragment f = this->factor();
+      res = this->thompson.cat(std::move(res), std::move(f));
     }
 
     return res;
   }
 
-  NFA regex(){
-    NFA res = this->term();
+  Thompson::Fragment regex(){
+    Thompson::Fragment res = this->term();
     if(this->more() && this->peek() == '|'){
       this->consume('|');
-      return RegexNFA::unite(res, this->regex());
+      Thompson::Fragment rest = this->regex();
+      return this->thompson.unite(std::move(res), std::move(rest));
     } else
       return res;
   }
 
+  // the whole pattern, as one NFA built in a single pass
+  NFA compile(){
+    return this->thompson.finish(this->regex());
+  }
+
   void build(){
-    dfa = regex().powerset().minimized();
+    dfa = this->compile().powerset().minimized(method);
+    dfa.compile();
     // dfa.dump();
   }
 public:
-  Regex(std::string s) : in(s) {
+  Regex(std::string s, MinimizeMethod method = MINIMIZE_HOPCROFT)
+    : in(s), thompson(2 * s.size()), method(method) {
     this->build();
   }
 
+  // an already compiled DFA, e.g. one RegexCache read from disk
+  explicit Regex(const DFA & dfa) : dfa(dfa), method(MINIMIZE_HOPCROFT) {}
+
+  Regex(std::string s, RegexMode mode, int cache_states = LAZY_DFA_STATES)
+    : in(s), thompson(2 * s.size()), method(MINIMIZE_HOPCROFT), mode(mode) {
+    if(mode == REGEX_EAGER){
+      this->build();
+      return;
+    }
+
+    this->nfa = this->compile();
+    if(mode == REGEX_AUTO){
+      CsrAutomaton det = CsrAutomaton(this->nfa).powerset(cache_states);
+      if(det.size()){
+        dfa = det.to_dfa().minimized(method);
+        dfa.compile();
+        this->nfa = NFA();
+        return;
+      }
+    }
+
+    this->lazy.reset(new LazyDFA(this->nfa, cache_states));
+  }
+
   bool run(const std::string & s) const {
+    if(this->lazy)
+      return this->lazy->run(s);
     return dfa.run(s);
   }
 
+  // see DFA::run_batch. lazy regexes go one string at a time, as a new
+  // state may flush the states other strings are in.
+  void run_batch(const char * data, const size_t * begin, const size_t * end,
+                 int n, char * results) const {
+    if(!this->lazy){
+      this->dfa.run_batch(data, begin, end, n, results);
+      return;
+    }
+
+    for(int i = 0; i < n; i++)
+      results[i] = this->lazy->run(data + begin[i], end[i] - begin[i]);
+  }
+
+  // a lazy regex determinizes its whole NFA here
   DFA get_dfa() const {
+    if(this->lazy){
+      DFA res = this->nfa.powerset().minimized(this->method);
+      res.compile();
+      return res;
+    }
     return this->dfa;
   }
+
+  const LazyDFA * get_lazy_dfa() const {
+    return this->lazy.get();
+  }
 };
@@ -0,0 +1,317 @@
+#include "regex_cache.hpp"
+#include "blob.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+#include <unistd.h>
+
+RegexCache & RegexCache::global(){
+  static RegexCache cache;
+  return cache;
+}
+
+std::shared_ptr<const Regex> RegexCache::find(const std::string & key){
+  auto it = this->m_index.find(key);
+  if(it == this->m_index.end()){
+    this->m_misses++;
+    return nullptr;
+  }
+
+  this->m_hits++;
+  this->m_lru.splice(this->m_lru.begin(), this->m_lru, it->second);
+  return it->second->second;
+}
+
+void RegexCache::insert(const std::string & key,
+                        std::shared_ptr<const Regex> re){
+  this->m_lru.emplace_front(key, re);
+  this->m_index[key] = this->m_lru.begin();
+
+  while(this->m_lru.size() > this->m_capacity){
+    this->m_index.erase(this->m_lru.back().first);
+    this->m_lru.pop_back();
+  }
+}
+
+namespace {
+
+// reads a pattern the way Regex parses it and prints it back canonically.
+// every procedure also says whether what it printed is a single atom,
+// which needs no parentheses around it.
+class PatternNormalizer{
+private:
+  const std::string & s;
+  size_t p = 0;
+
+  char next(){
+    if(!this->more())
+      throw std::runtime_error("unexpected end of pattern");
+    return this->s[this->p++];
+  }
+
+  static std::string atom(char c){
+    if(c && strchr("\\[()|*+?", c))
+      return std::string("\\") + c;
+    return std::string(1, c);
+  }
+
+  // a postfix operator applied after another one
+  static char fold(char a, char b){
+    if(!a || a == b)
+      return b;
+    return '*';
+  }
+
+  std::string range(bool & atomic){
+    size_t begin = this->p;
+    atomic = true;
+    this->next();
+
+    bool invert = this->more() && this->peek() == '^';
+    if(invert)
+      this->p++;
+
+    std::vector<std::pair<int, int>> v;
+    bool plain = true;
+    while(this->peek() != ']'){
+      int first = this->next(), second = first;
+      if(this->more() && this->peek() == '-'){
+        this->p++;
+        second = this->next();
+      }
+
+      // these endpoints do not print back unambiguously
+      plain &= first <= second && first != ']' && first != '-'
+        && second != ']' && second != '-';
+      v.push_back(std::make_pair(first, second));
+    }
+    this->next();
+
+    if(!plain || v.empty())
+      return this->s.substr(begin, this->p - begin);
+
+    std::sort(v.begin(), v.end());
+    std::vector<std::pair<int, int>> merged;
+    for(const auto & r : v){
+      if(!merged.empty() && r.first <= merged.back().second + 1)
+        merged.back().second = std::max(merged.back().second, r.second);
+      else
+        merged.push_back(r);
+    }
+
+    if(!invert && merged.size() == 1 && merged[0].first == merged[0].second)
+      return atom(merged[0].first);
+
+    // a leading ^ would invert the bracket
+    if(!invert && merged[0].first == '^'){
+      if(merged.size() == 1)
+        return this->s.substr(begin, this->p - begin);
+      std::rotate(merged.begin(), merged.begin() + 1, merged.end());
+    }
+
+    std::string res = invert ? "[^" : "[";
+    for(const auto & r : merged){
+      res += (char)r.first;
+      if(r.second != r.first){
+        res += '-';
+        res += (char)r.second;
+      }
+    }
+    return res + "]";
+  }
+
+  std::string base(bool & atomic){
+    atomic = true;
+    if(this->peek() == '\\'){
+      this->p++;
+      return atom(this->next());
+    } else if(this->peek() == '['){
+      return this->range(atomic);
+    } else if(this->peek() == '('){
+      this->p++;
+      bool inner;
+      std::string res = this->regex(inner);
+      if(this->next() != ')')
+        throw std::runtime_error("expected )");
+      return inner ? res : "(" + res + ")";
+    }
+
+    return atom(this->next());
+  }
+
+  std::string factor(bool & atomic){
+    std::string res = this->base(atomic);
+    char op = 0;
+    while(this->more() && strchr("*+?", this->peek()))
+      op = fold(op, this->next());
+
+    if(op){
+      atomic = false;
+      res += op;
+    }
+    return res;
+  }
+
+  std::string term(bool & atomic){
+    std::string res;
+    int factors = 0;
+    atomic = false;
+    while(this->more() && this->peek() != ')' && this->peek() != '|'){
+      res += this->factor(atomic);
+      factors++;
+    }
+
+    atomic &= factors == 1;
+    return res;
+  }
+
+public:
+  PatternNormalizer(const std::string & s) : s(s) {}
+
+  bool more() const { return this->p < this->s.size(); }
+  char peek() const { return this->more() ? this->s[this->p] : 0; }
+
+  std::string regex(bool & atomic){
+    std::string res = this->term(atomic);
+    if(this->more() && this->peek() == '|'){
+      this->p++;
+      res += '|';
+      res += this->regex(atomic);
+      atomic = false;
+    }
+    return res;
+  }
+};
+
+}
+
+std::string RegexCache::normalize(const std::string & pattern){
+  try {
+    // like Regex, anything after the pattern proper is ignored
+    bool atomic;
+    return PatternNormalizer(pattern).regex(atomic);
+  } catch(std::runtime_error &){
+    return pattern;
+  }
+}
+
+// keys start with how the pattern is compiled, so one pattern can be
+// cached both eagerly and lazily, or minimized both ways
+std::shared_ptr<const Regex> RegexCache::get(const std::string & pattern,
+                                             MinimizeMethod method){
+  std::string key = (method == MINIMIZE_HOPCROFT ? "H:" : "B:")
+    + normalize(pattern);
+  std::shared_ptr<const Regex> res = this->find(key);
+  if(res)
+    return res;
+
+  DFA dfa;
+  if(this->read(key, dfa)){
+    this->m_disk_hits++;
+    res = std::make_shared<const Regex>(dfa);
+  } else {
+    res = std::make_shared<const Regex>(pattern, method);
+    this->write(key, res->get_dfa());
+  }
+
+  this->insert(key, res);
+  return res;
+}
+
+std::shared_ptr<const Regex> RegexCache::get(const std::string & pattern,
+                                             RegexMode mode){
+  if(mode == REGEX_EAGER)
+    return this->get(pattern, MINIMIZE_HOPCROFT);
+
+  std::string key = (mode == REGEX_LAZY ? "L:" : "A:") + normalize(pattern);
+  std::shared_ptr<const Regex> res = this->find(key);
+  if(!res){
+    res = std::make_shared<const Regex>(pattern, mode);
+    this->insert(key, res);
+  }
+  return res;
+}
+
+void RegexCache::set_capacity(size_t n){
+  this->m_capacity = std::max<size_t>(n, 1);
+  while(this->m_lru.size() > this->m_capacity){
+    this->m_index.erase(this->m_lru.back().first);
+    this->m_lru.pop_back();
+  }
+}
+
+void RegexCache::set_directory(const std::string & dir){
+  this->m_directory = dir;
+}
+
+void RegexCache::clear(){
+  this->m_lru.clear();
+  this->m_index.clear();
+  this->m_hits = this->m_misses = this->m_disk_hits = 0;
+}
+
+// FNV-1a of the key; files also store the key to rule out collisions
+std::string RegexCache::path(const std::string & key) const{
+  uint64_t h = 0xcbf29ce484222325ULL;
+  for(char c : key){
+    h ^= (unsigned char)c;
+    h *= 0x100000001b3ULL;
+  }
+
+  char name[32];
+  snprintf(name, sizeof name, "%016llx.dfa", (unsigned long long)h);
+  return this->m_directory + "/" + name;
+}
+
+bool RegexCache::read(const std::string & key, DFA & dfa) const{
+  if(this->m_directory.empty())
+    return false;
+
+  std::ifstream in(this->path(key).c_str(), std::ifstream::binary);
+  if(!in.is_open())
+    return false;
+
+  std::string data((std::istreambuf_iterator<char>(in)),
+                   std::istreambuf_iterator<char>());
+  BlobReader blob(data.data(), data.size());
+
+  int32_t magic;
+  std::vector<char> stored;
+  if(!blob.read(magic) || magic != REGEX_CACHE_MAGIC || !blob.read(stored))
+    return false;
+  if(std::string(stored.begin(), stored.end()) != key)
+    return false;
+  if(!dfa.load(blob) || blob.p != blob.end)
+    return false;
+
+  dfa.decompile();
+  return true;
+}
+
+// into a file of this process's own, renamed over the target once
+// complete, so concurrent writers and readers never see a partial file
+void RegexCache::write(const std::string & key, const DFA & dfa) const{
+  if(this->m_directory.empty())
+    return;
+
+  static std::atomic<unsigned> written(0);
+  std::string target = this->path(key);
+  std::string temp = target + ".tmp." + std::to_string(getpid())
+    + "." + std::to_string(written++);
+
+  std::ofstream out(temp.c_str(), std::ofstream::binary);
+  if(!out.is_open())
+    return;
+
+  blob_write(out, (int32_t)REGEX_CACHE_MAGIC);
+  blob_write(out, std::vector<char>(key.begin(), key.end()));
+  dfa.save(out);
+  out.close();
+
+  if(!out || rename(temp.c_str(), target.c_str()) != 0)
+    remove(temp.c_str());
+}
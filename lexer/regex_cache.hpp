@@ -0,0 +1,58 @@
+#pragma once
+
+#include "regex.hpp"
+#include <list>
+#include <memory>
+#include <string>
+#include <unordered_map>
+
+#define REGEX_CACHE_ENTRIES 256
+#define REGEX_CACHE_MAGIC 0x31435852 // "RXC1"
+
+// Process-wide LRU cache of compiled regexes, keyed by the pattern and
+// how it is compiled. Minimized DFAs can also be persisted to a cache
+// directory, one file per pattern, and are then reused across runs.
+class RegexCache{
+private:
+  typedef std::pair<std::string, std::shared_ptr<const Regex>> Entry;
+
+  std::list<Entry> m_lru; // most recently used first
+  std::unordered_map<std::string, std::list<Entry>::iterator> m_index;
+  size_t m_capacity = REGEX_CACHE_ENTRIES;
+  std::string m_directory;
+
+  size_t m_hits = 0, m_misses = 0, m_disk_hits = 0;
+
+  std::shared_ptr<const Regex> find(const std::string & key);
+  void insert(const std::string & key, std::shared_ptr<const Regex>);
+
+  std::string path(const std::string & key) const;
+  bool read(const std::string & key, DFA &) const;
+  void write(const std::string & key, const DFA &) const;
+
+public:
+  static RegexCache & global();
+
+  // the pattern in a canonical spelling, which keys the cache: needless
+  // escapes and parentheses dropped, repeated postfix operators folded,
+  // bracket ranges sorted and merged. malformed patterns are kept as is.
+  static std::string normalize(const std::string & pattern);
+
+  std::shared_ptr<const Regex> get(const std::string & pattern,
+                                   MinimizeMethod = MINIMIZE_HOPCROFT);
+  std::shared_ptr<const Regex> get(const std::string & pattern, RegexMode);
+
+  void set_capacity(size_t);
+  // empty turns persistence off; the directory has to exist
+  void set_directory(const std::string &);
+  void clear();
+
+  size_t size() const { return m_lru.size(); }
+  size_t hits() const { return m_hits; }
+  size_t misses() const { return m_misses; }
+  size_t disk_hits() const { return m_disk_hits; }
+  double hit_rate() const {
+    size_t total = m_hits + m_misses;
+    return total ? (double)m_hits / total : 0;
+  }
+};
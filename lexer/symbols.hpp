@@ -0,0 +1,71 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstring>
+
+// Interns lexemes into dense ids. Lookups hash the raw bytes, so finding
+// an already known symbol does not allocate.
+class SymbolTable {
+private:
+  std::vector<std::string> m_names;
+  std::vector<uint64_t> m_hashes;
+  std::vector<int> m_slots;
+
+  static uint64_t hash(const char * s, int n){
+    uint64_t h = 0xcbf29ce484222325ULL;
+    for(int i = 0; i < n; i++){
+      h ^= (unsigned char)s[i];
+      h *= 0x100000001b3ULL;
+    }
+    return h;
+  }
+
+  void grow(){
+    std::vector<int> slots(m_slots.empty() ? 256 : 2 * m_slots.size(), -1);
+    size_t mask = slots.size() - 1;
+    for(int i = 0; i < this->size(); i++){
+      size_t p = m_hashes[i] & mask;
+      while(slots[p] != -1)
+        p = (p + 1) & mask;
+      slots[p] = i;
+    }
+    m_slots.swap(slots);
+  }
+
+public:
+  int size() const {
+    return m_names.size();
+  }
+
+  const std::string & name(int id) const {
+    return m_names[id];
+  }
+
+  int intern(const char * s, int n){
+    if(2 * (this->size() + 1) > (int)m_slots.size())
+      this->grow();
+
+    uint64_t h = hash(s, n);
+    size_t mask = m_slots.size() - 1;
+    size_t p = h & mask;
+    while(m_slots[p] != -1){
+      int i = m_slots[p];
+      if(m_hashes[i] == h && (int)m_names[i].size() == n
+          && !memcmp(m_names[i].data(), s, n))
+        return i;
+      p = (p + 1) & mask;
+    }
+
+    int i = this->size();
+    m_slots[p] = i;
+    m_hashes.push_back(h);
+    m_names.emplace_back(s, n);
+    return i;
+  }
+
+  int intern(const std::string & s){
+    return this->intern(s.data(), s.size());
+  }
+};
@@ -0,0 +1,81 @@
+#include "thompson.hpp"
+
+Thompson::Thompson(int reserve){
+  this->m_nfa.states().reserve(reserve + 1);
+  this->add_state();
+}
+
+int Thompson::add_state(){
+  return this->m_nfa.add_state();
+}
+
+void Thompson::patch(const std::vector<int> & out, int to){
+  for(int x : out)
+    this->m_nfa.state(x).add_transition(EPSILON, to);
+}
+
+Thompson::Fragment Thompson::empty(){
+  int s = this->add_state();
+  return {s, {s}};
+}
+
+Thompson::Fragment Thompson::atom(const std::vector<CharRange> & v){
+  int s = this->add_state();
+  int t = this->add_state();
+  for(const CharRange & range : v)
+    this->m_nfa.state(s).add_transition(range, t);
+  return {s, {t}};
+}
+
+Thompson::Fragment Thompson::atom(CharRange range){
+  return this->atom(std::vector<CharRange>(1, range));
+}
+
+Thompson::Fragment Thompson::cat(Fragment a, Fragment b){
+  this->patch(a.out, b.start);
+  return {a.start, std::move(b.out)};
+}
+
+// the shorter patch list is appended to the longer one
+Thompson::Fragment Thompson::unite(Fragment a, Fragment b){
+  int s = this->add_state();
+  this->m_nfa.state(s).add_transition(EPSILON, a.start);
+  this->m_nfa.state(s).add_transition(EPSILON, b.start);
+
+  if(a.out.size() < b.out.size())
+    std::swap(a.out, b.out);
+  a.out.insert(a.out.end(), b.out.begin(), b.out.end());
+  return {s, std::move(a.out)};
+}
+
+Thompson::Fragment Thompson::kleene(Fragment a){
+  int s = this->add_state();
+  this->m_nfa.state(s).add_transition(EPSILON, a.start);
+  this->patch(a.out, s);
+  return {s, {s}};
+}
+
+Thompson::Fragment Thompson::kleene_plus(Fragment a){
+  int s = this->add_state();
+  this->m_nfa.state(s).add_transition(EPSILON, a.start);
+  this->patch(a.out, s);
+  return {a.start, {s}};
+}
+
+Thompson::Fragment Thompson::zero_one(Fragment a){
+  int s = this->add_state();
+  this->m_nfa.state(s).add_transition(EPSILON, a.start);
+  a.out.push_back(s);
+  return {s, std::move(a.out)};
+}
+
+NFA Thompson::finish(const Fragment & f){
+  this->m_nfa.state(0).add_transition(EPSILON, f.start);
+  for(int x : f.out)
+    this->m_nfa.state(x).is_final = true;
+
+  NFA res;
+  std::swap(res, this->m_nfa);
+  this->add_state();
+  return res;
+}
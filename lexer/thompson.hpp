@@ -0,0 +1,42 @@
+#pragma once
+
+#include "common.hpp"
+#include "nfa.hpp"
+#include <vector>
+
+// Thompson construction into a single NFA. Every operation appends a
+// constant number of states and links fragments through epsilon moves,
+// so nothing built earlier is ever copied.
+class Thompson{
+public:
+  // a piece of the NFA entered at start and left from the states in out,
+  // which still wait to be patched to whatever follows
+  struct Fragment{
+    int start;
+    std::vector<int> out;
+  };
+
+private:
+  NFA m_nfa;
+
+  int add_state();
+  void patch(const std::vector<int> & out, int to);
+
+public:
+  // state 0 is reserved for the entry, linked by finish(). states
+  // are reserved up front when their count can be estimated.
+  Thompson(int reserve = 0);
+
+  Fragment empty();
+  Fragment atom(const std::vector<CharRange> &);
+  Fragment atom(CharRange);
+
+  Fragment cat(Fragment, Fragment);
+  Fragment unite(Fragment, Fragment);
+  Fragment kleene(Fragment);
+  Fragment kleene_plus(Fragment);
+  Fragment zero_one(Fragment);
+
+  // the NFA accepting f, leaving the builder empty
+  NFA finish(const Fragment & f);
+};
@@ -3,16 +3,27 @@
 #include <string>
 #include <utility>
 
+#define NO_SYMBOL (-1)
+
+// A token is a view into the input buffer, which has to outlive it.
 struct Token {
   int type;
-  std::string lexeme;
+  const char * text;
+  int length;
   std::pair<int, int> location;
+  int symbol = NO_SYMBOL; // interned id, for rules the lexer interns
+
+  Token() : type(0), text(0), length(0) {}
+  Token(int type, const char * text, int length, std::pair<int, int> location,
+        int symbol = NO_SYMBOL)
+    : type(type), text(text), length(length), location(location),
+      symbol(symbol) {}
 
   bool operator==(const int rhs) const {
     return type == rhs;
   }
 
-  const char * c_str() const {
-    return lexeme.c_str();
+  std::string lexeme() const {
+    return std::string(text, length);
   }
 };
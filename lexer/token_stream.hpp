@@ -0,0 +1,74 @@
+#pragma once
+
+#include "lexer.hpp"
+#include <cassert>
+
+#define TOKEN_WINDOW 4
+
+// Pulls tokens from a Lexer on demand, keeping only the last
+// TOKEN_WINDOW of them around. Tokens are addressed by their absolute
+// index, which must stay inside the window.
+//
+// A lexical error ends the stream unless the error handler returns
+// true, in which case the offending character is skipped.
+class TokenStream {
+public:
+  typedef bool (*ErrorHandler)(const Token &);
+
+private:
+  Lexer & m_lexer;
+  Stream & m_stream;
+  ErrorHandler m_on_error;
+
+  Token m_ring[TOKEN_WINDOW];
+  int m_count = 0;
+  bool m_done = false;
+
+  bool fill(){
+    if(m_done)
+      return false;
+
+    Token & tok = m_ring[m_count % TOKEN_WINDOW];
+    while(true){
+      if(!m_lexer.next(m_stream, tok)){
+        m_done = true;
+        return false;
+      }
+
+      if(tok.type != LEXER_ERROR)
+        break;
+
+      if(!m_on_error || !m_on_error(tok)){
+        m_done = true;
+        return false;
+      }
+      m_stream.reset(tok.text - m_stream.data() + 1);
+    }
+
+    m_count++;
+    return true;
+  }
+
+public:
+  TokenStream(Lexer & lexer, Stream & stream, ErrorHandler on_error = 0)
+    : m_lexer(lexer), m_stream(stream), m_on_error(on_error) {}
+
+  // token i, or 0 past the end of the input
+  const Token * get(int i){
+    assert(i >= 0 && i > m_count - TOKEN_WINDOW);
+    while(i >= m_count)
+      if(!this->fill())
+        return 0;
+    return &m_ring[i % TOKEN_WINDOW];
+  }
+
+  // names of the symbols carried by the tokens
+  SymbolTable & symbols(){
+    return m_lexer.symbols();
+  }
+
+  // number of tokens lexed so far
+  int count() const {
+    return m_count;
+  }
+};
@@ -0,0 +1,72 @@
+#include "def_lexer.hpp"
+#include "lexer/lexer.hpp"
+#include <cstdio>
+#include <string>
+
+/*
+ * Builds the Def lexer and prints its combined DFA as a C++ header of
+ * constexpr arrays, so the compiler does not construct any automaton
+ * at runtime. Usage: lexgen [output_file]
+ */
+
+template<typename T>
+void print_array(FILE * out, const char * type, const char * name,
+                 const T * v, int n){
+  fprintf(out, "constexpr %s %s[] = {", type, name);
+  for(int i = 0; i < n; i++)
+    fprintf(out, "%s%s%d", i ? "," : "", i % 16 ? " " : "\n  ", (int)v[i]);
+  fprintf(out, "\n};\n\n");
+}
+
+void print_strings(FILE * out, const char * name,
+                   const char * const * v, int n){
+  fprintf(out, "constexpr const char * %s[] = {", name);
+  for(int i = 0; i < n; i++)
+    fprintf(out, "%s\n  \"%s\"", i ? "," : "", v[i]);
+  fprintf(out, "\n};\n\n");
+}
+
+int main(int argc, char ** argv){
+  Lexer lexer;
+  setup_def_lexer(lexer);
+  LexerTables t = lexer.tables();
+
+  FILE * out = argc > 1 ? fopen(argv[1], "w") : stdout;
+  if(!out){
+    fprintf(stderr, "output file %s could not be opened\n", argv[1]);
+    return 1;
+  }
+
+  fprintf(out, "#pragma once\n\n");
+  fprintf(out, "// generated by lexgen from def_lexer.cpp, do not edit\n\n");
+  fprintf(out, "#include \"lexer/lexer.hpp\"\n\n");
+  fprintf(out, "namespace DefTables{\n\n");
+  fprintf(out, "constexpr int RULES = %d;\n", t.rules);
+  fprintf(out, "constexpr int STATES = %d;\n", t.states);
+  fprintf(out, "constexpr int CLASSES = %d;\n", t.classes);
+  fprintf(out, "constexpr int16_t KEYWORD_RULE = %d;\n", t.keyword_rule);
+  fprintf(out, "constexpr uint32_t KEYWORD_SEED = %u;\n", t.keyword_seed);
+  fprintf(out, "constexpr int KEYWORD_SLOTS = %d;\n\n", t.keyword_slots);
+
+  print_array(out, "int16_t", "NAMES", t.names, t.rules);
+  print_array(out, "char", "HIDDEN", t.hidden, t.rules);
+  print_array(out, "uint8_t", "CLASS_MAP", t.class_map, DFA_BYTES);
+  print_array(out, "int32_t", "NEXT", t.next, t.states * t.classes);
+  print_array(out, "char", "FINAL", t.final, t.states);
+  print_array(out, "int", "TAG", t.tag, t.states);
+  print_strings(out, "KEYWORD_WORDS", t.keyword_words, t.keyword_slots);
+  print_array(out, "int16_t", "KEYWORD_TYPES", t.keyword_types,
+              t.keyword_slots);
+
+  fprintf(out, "inline LexerTables tables(){\n");
+  fprintf(out, "  return {RULES, NAMES, HIDDEN, STATES, CLASSES,\n");
+  fprintf(out, "          CLASS_MAP, NEXT, FINAL, TAG,\n");
+  fprintf(out, "          KEYWORD_RULE, KEYWORD_SEED, KEYWORD_SLOTS,\n");
+  fprintf(out, "          KEYWORD_WORDS, KEYWORD_TYPES};\n");
+  fprintf(out, "}\n\n");
+  fprintf(out, "}\n");
+
+  if(out != stdout)
+    fclose(out);
+  return 0;
+}
@@ -2,30 +2,26 @@
 #include "common/stream.hpp"
 #include "lexer/regex.hpp"
 #include "lexer/lexer.hpp"
+#include "lexer/regex_cache.hpp"
+#include "def_lexer.hpp"
+#include "def_tables.hpp"
+#include "common/errors.hpp"
 #include "tclap/CmdLine.h"
 #include <string>
 #include <iostream>
 #include <fstream>
 #include <cassert>
+#include <memory>
 
 #define sz(x) ((int)x.size())
 
 using namespace std;
 
-int tokens_ptr;
-int cur_ptr;
-vector<Token> tokens;
 Lexer lexer;
-
-std::streambuf * get_input_buf(const char * s){
-  std::ifstream * res = new std::ifstream;
-  res->open(s, std::ifstream::in);
-  if(!res->is_open()){
-    fprintf(stderr, "input file %s could not be opened\n", s);
-    exit(1);
-  }
-  return res->rdbuf();
-}
+unique_ptr<Stream> input; // tokens point into its buffer
+unique_ptr<TokenStream> tokens;
+AST ast(lexer.symbols()); // every AST node
+ErrorLog errors; // lexical and syntax errors
 
 std::streambuf * get_output_buf(const char * s){
   std::ofstream * res = new std::ofstream;
@@ -33,125 +29,99 @@ std::streambuf * get_output_buf(const char * s){
   return res->rdbuf();
 }
 
-std::string unite(std::vector<std::string> s){
-  std::string res;
-  for(std::string x : s){
-    res += x;
-    res += '|';
+void setup_output(std::string output_fn){
+  if(!output_fn.empty()){
+    FILE * opened = freopen(output_fn.c_str(), "w", stdout);
   }
-
-  if(!s.empty())
-    res.pop_back();
-
-  return res;
 }
 
-string escape(const string & s){
-  string res;
-  for(char c : s){
-    res += "\\";
-    res += c;
-  }
-  return res;
+bool lexical_error(const Token & tok){
+  char msg[64];
+  sprintf(msg, "lexical error in %d:%d", tok.location.first, tok.location.second);
+  if(!errors.report(msg))
+    exit(1);
+  return true;
 }
 
-std::vector<std::string> escape(std::vector<std::string> s){
-  for(string & x : s){
-    x = escape(x);
+void run_lexer(std::string input_fn){
+  // input setup
+  input.reset(!input_fn.empty() ?
+    new Stream(input_fn.c_str()) : new Stream(std::cin));
+
+  if(!input->is_open()){
+    fprintf(stderr, "input file %s could not be opened\n", input_fn.c_str());
+    exit(1);
   }
 
-  return s;
+  // tokens are pulled by the parser as it goes
+  tokens.reset(new TokenStream(lexer, *input, lexical_error));
 }
 
-void setup_output(std::string output_fn){
-  if(!output_fn.empty()){
-    FILE * opened = freopen(output_fn.c_str(), "w", stdout);
-  }
+void do_lexing(){
+  for(int i = tokens->count(); tokens->get(i); i++);
+  if(errors.count())
+    exit(1);
 }
 
-void run_lexer(std::string input_fn){
-  // input setup
-  std::istream in(!input_fn.empty() ? get_input_buf(input_fn.c_str()) : std::cin.rdbuf());
-  Stream st(in);
-
-  // run lexer
-  tokens = lexer.run(st);
-  tokens_ptr = cur_ptr = 0;
-
-  // check for lexical errors
-  for(Token & tok : tokens){
-    if(tok.type == LEXER_ERROR){
-      fprintf(stderr, "lexical error in %d:%d\n", tok.location.first, tok.location.second);
-      exit(1);
-    }
+void setup_lexer(std::string tables_fn, bool from_rules){
+  lexer.intern(T_ID);
+
+  // tables generated at build time, see lexgen.cpp
+  if(tables_fn.empty() && !from_rules){
+    lexer.load(DefTables::tables());
+    return;
+  }
+
+  // the rules go through RegexCache, which may have them on disk
+  if(tables_fn.empty()){
+    setup_def_lexer(lexer);
+    return;
   }
-}
 
-void setup_lexer(){
-  std::vector<std::string> syms = {
-    "(",
-    "{",
-    "[",
-    "]",
-    "}",
-    ")",
-    ",",
-    ";",
-    "=",
-    "+",
-    "-",
-    "*",
-    "/",
-    "<",
-    ">",
-    "!"
-  };
-
-  syms = escape(syms);
-
-  lexer.add_hidden_rule(0, "[ \n\t\r]+"); // white
-  lexer.add_hidden_rule(0, "//[^\n]*"); // comment
-
-  lexer.add_rule(T_IF, escape("if"));
-  lexer.add_rule(T_BREAK, escape("break"));
-  lexer.add_rule(T_CONTINUE, escape("continue"));
-  lexer.add_rule(T_WHILE, escape("while"));
-  lexer.add_rule(T_DEF, escape("def"));
-  lexer.add_rule(T_ELSE, escape("else"));
-  lexer.add_rule(T_INT, escape("int"));
-  lexer.add_rule(T_VOID, escape("void"));
-  lexer.add_rule(T_RETURN, escape("return"));
-
-  lexer.add_rule(T_ID, "[a-zA-Z][a-zA-Z0-9_]*");
-  lexer.add_rule(T_DEC, "[0-9]+");
-  lexer.add_rule(0, unite(syms));
-
-  lexer.add_rule(T_LEQ, escape("<="));
-  lexer.add_rule(T_GEQ, escape(">="));
-  lexer.add_rule(T_EQ, escape("=="));
-  lexer.add_rule(T_NEQ, escape("!="));
-  lexer.add_rule(T_AND, escape("&&"));
-  lexer.add_rule(T_OR, escape("||"));
+  std::ifstream in(tables_fn.c_str(), std::ifstream::binary);
+  if(in.is_open() && lexer.load(in))
+    return;
+
+  setup_def_lexer(lexer);
+
+  std::ofstream out(tables_fn.c_str(), std::ofstream::binary);
+  if(out.is_open())
+    lexer.save(out);
+  else
+    fprintf(stderr, "lexer tables %s could not be written\n", tables_fn.c_str());
 }
 
-shared_ptr<ProgASTNode> do_parsing(){
-  Parser parser(tokens);
+NodeId do_parsing(){
+  Parser parser(*tokens, ast, &errors);
+  NodeId res;
+
+  try {
+    res = parser.program();
+  } catch(ErrorLimit &){
+    exit(1);
+  } catch(std::runtime_error &){
+    // lexical errors take precedence, even past the syntax error
+    do_lexing();
+    throw;
+  }
 
-  return parser.program();
+  if(errors.count())
+    exit(1);
+  return res;
 }
 
-void do_semantics(shared_ptr<ProgASTNode> root, Code & code){
-  ScopeStack sta;
-  root->check_and_generate(code, sta);
+void do_semantics(NodeId root, Code & code){
+  ScopeStack sta(lexer.symbols());
+  generate(ast, root, code, sta);
 }
 
 int main(int argc, char ** argv){
   /*
   * COMMAND LINE PARSING
   **/
-  std::string input_fn, output_fn;
-  int phase;
-  bool output_data;
+  std::string input_fn, output_fn, tables_fn, regex_cache_dir;
+  int phase, max_errors;
+  bool output_data, regex_cache_stats;
 
   TCLAP::CmdLine cmd("MATA61 Def Compiler", ' ', "2016.2");
 
@@ -174,11 +144,38 @@ int main(int argc, char ** argv){
     3,
     "phase");
 
+  TCLAP::ValueArg<std::string> tables_cmd("t",
+    "tables",
+    "precompiled lexer tables (written there when missing or invalid)",
+    false,
+    "",
+    "tables_file");
+
+  TCLAP::ValueArg<std::string> regex_cache_cmd("c",
+    "regex-cache",
+    "directory where compiled lexer rules are cached across runs (the rules are then compiled instead of using the built-in tables, unless -t loads valid tables)",
+    false,
+    "",
+    "directory");
+
+  TCLAP::SwitchArg regex_cache_stats_cmd("s", "regex-cache-stats", "print regex cache hits and misses once the lexer is set up", false);
+
+  TCLAP::ValueArg<int> max_errors_cmd("e",
+    "max-errors",
+    "lexical and syntax errors reported before giving up (above 1, parsing recovers from each one)",
+    false,
+    1,
+    "count");
+
   TCLAP::SwitchArg output_cmd("n", "no-output", "supress output data from earlier phases", true);
 
   cmd.add(input_fn_cmd);
   cmd.add(output_fn_cmd);
   cmd.add(phase_cmd);
+  cmd.add(tables_cmd);
+  cmd.add(regex_cache_cmd);
+  cmd.add(regex_cache_stats_cmd);
+  cmd.add(max_errors_cmd);
   cmd.add(output_cmd);
 
   cmd.parse(argc, argv);
@@ -187,17 +184,31 @@ int main(int argc, char ** argv){
   output_fn = output_fn_cmd.getValue();
   phase = phase_cmd.getValue();
   output_data = output_cmd.getValue();
+  tables_fn = tables_cmd.getValue();
+  regex_cache_dir = regex_cache_cmd.getValue();
+  regex_cache_stats = regex_cache_stats_cmd.getValue();
+  max_errors = max_errors_cmd.getValue();
 
   /* Actual code */
   setup_output(output_fn);
-  setup_lexer();
+  errors.set_max(max_errors);
+  RegexCache::global().set_directory(regex_cache_dir);
+  setup_lexer(tables_fn, !regex_cache_dir.empty());
+
+  if(regex_cache_stats){
+    const RegexCache & cache = RegexCache::global();
+    fprintf(stderr, "regex cache: %zu hits, %zu misses (%zu read from disk), %.1f%% hit rate\n",
+      cache.hits(), cache.misses(), cache.disk_hits(), 100 * cache.hit_rate());
+  }
 
   run_lexer(input_fn);
 
-  shared_ptr<ProgASTNode> root;
+  NodeId root = NO_NODE;
 
   if(phase >= 1){
     root = do_parsing();
+  } else {
+    do_lexing();
   }
 
   if(phase >= 2){
@@ -210,7 +221,7 @@ int main(int argc, char ** argv){
   }
 
   if((phase == 1 || phase == 2) && output_data){
-    root->print_node();
+    ast.print_node(root);
     puts("");
   }
 
@@ -3,99 +3,136 @@
 std::map<int, std::string> Parsing::types;
 char Parsing::buf[BUF_SZ];
 
-shared_ptr<ProgASTNode> Parser::program(){
-  auto res = make_shared<ProgASTNode>();
-  while(peek() == T_INT || peek() == T_VOID || peek() == T_DEF){
-    if(peek() == T_DEF)
-      res->append(decfunc());
-    else if(peek() == T_INT || peek() == T_VOID)
-      res->append(decvar());
-    else
-      unexpected();
+NodeId Parser::program(){
+  Location at = loc();
+  std::vector<NodeId> items;
+  while(true){
+    int first = peek();
+    try {
+      if(first == T_DEF)
+        items.push_back(decfunc());
+      else if(first == T_INT || first == T_VOID)
+        items.push_back(decvar());
+      else {
+        expect(EOF);
+        break;
+      }
+    } catch(std::runtime_error & e){
+      recover(e);
+      // a bad global ends at its ';', anything else at the next def
+      if(first == T_INT || first == T_VOID)
+        synchronize();
+      else {
+        while(peek() != EOF && peek() != T_DEF)
+          consume();
+      }
+    }
   }
-  expect(EOF);
-  return res;
+  return ast.add(NODE_PROG, 0, at, items);
 }
 
-shared_ptr<TypeASTNode> Parser::type(){
+NodeId Parser::type(){
+  Location at = loc();
   if(peek() == T_INT) {
     consume(T_INT);
-    return make_shared<TypeASTNode>(make_shared<ASTNode>("int"));
+    return ast.add(NODE_TYPE, false, at);
   }
   else if(peek() == T_VOID) {
     consume(T_VOID);
-    return make_shared<TypeASTNode>(make_shared<ASTNode>("void"));
+    return ast.add(NODE_TYPE, true, at);
   }
   else unexpected();
 
   throw runtime_error("parsing recursion error");
 }
 
-shared_ptr<DecvarASTNode> Parser::decvar(){
+NodeId Parser::decvar(){
+  Location at = loc();
   auto t = type();
   expect(T_ID);
-  auto id = consume_node<IdASTNode>();
-  auto var = make_shared<VarASTNode>(id, t);
-  shared_ptr<DecvarASTNode> res;
+  auto id = consume_id();
+  auto var = ast.add(NODE_VAR, 0, at, {id, t});
+  NodeId res;
 
   if(peek() == '='){
     consume('=');
-    res = make_shared<DecvarASTNode>(var, expr());
+    res = ast.add(NODE_DECVAR, 0, at, {var, expr()});
   } else {
-    res = make_shared<DecvarASTNode>(var);
+    res = ast.add(NODE_DECVAR, 0, at, {var});
   }
 
   consume(';');
   return res;
 }
 
-shared_ptr<DecfuncASTNode> Parser::decfunc(){
+NodeId Parser::decfunc(){
+  Location at = loc();
   consume(T_DEF);
+  Location var_at = loc();
   auto t = type();
   expect(T_ID);
-  auto id = consume_node<IdASTNode>();
-  auto var = make_shared<VarASTNode>(id, t);
-  auto list = make_shared<ParamsASTNode>();
+  auto id = consume_id();
+  auto var = ast.add(NODE_VAR, 0, var_at, {id, t});
 
   consume('(');
-  if(peek() != ')')
-    list = params();
+  auto list = peek() != ')' ? params() : ast.add(NODE_PARAMS, 0, loc());
   consume(')');
 
   consume('{');
-  shared_ptr<BlockASTNode> code = block();
+  auto code = block();
   consume('}');
 
-  return make_shared<DecfuncASTNode>(var, list, code);
+  return ast.add(NODE_DECFUNC, 0, at, {var, list, code});
 }
 
-shared_ptr<ParamsASTNode> Parser::params(){
-  auto res = make_shared<ParamsASTNode>();
-  res->append(params1());
+NodeId Parser::params(){
+  Location at = loc();
+  std::vector<NodeId> items;
+  items.push_back(params1());
   while(peek() == ','){
     consume(',');
-    res->append(params1());
+    items.push_back(params1());
   }
-  return res;
+  return ast.add(NODE_PARAMS, 0, at, items);
 }
 
-shared_ptr<VarASTNode> Parser::params1(){
+NodeId Parser::params1(){
+  Location at = loc();
   auto t = type();
   expect(T_ID);
 
-  return make_shared<VarASTNode>(consume_node<IdASTNode>(), t);
+  return ast.add(NODE_VAR, 0, at, {consume_id(), t});
 }
 
-shared_ptr<BlockASTNode> Parser::block(){
-  auto res = make_shared<BlockASTNode>();
-  while(peek() == T_INT || peek() == T_VOID)
-    res->append_declaration(decvar());
-  while(peek() != '}')
-    res->append_statement(statement());
-  return res;
+NodeId Parser::block(){
+  Location at = loc();
+  std::vector<NodeId> items;
+  while(peek() == T_INT || peek() == T_VOID){
+    try {
+      items.push_back(decvar());
+    } catch(std::runtime_error & e){
+      recover(e);
+      synchronize();
+    }
+  }
+
+  int declarations = items.size();
+
+  // when recovering, a def or the end of the input means this block
+  // was never closed; the caller reports the missing '}'
+  while(peek() != '}'
+      && !(recovering() && (peek() == T_DEF || peek() == EOF))){
+    try {
+      items.push_back(statement());
+    } catch(std::runtime_error & e){
+      recover(e);
+      synchronize();
+    }
+  }
+  return ast.add(NODE_BLOCK, declarations, at, items);
 }
 
-shared_ptr<ASTNode> Parser::statement(){
+NodeId Parser::statement(){
   if(peek() == T_IF)
     return conditional();
   else if(peek() == T_WHILE)
@@ -105,14 +142,15 @@ shared_ptr<ASTNode> Parser::statement(){
     consume(';');
     return res;
   } else if(peek() == T_BREAK || peek() == T_CONTINUE){
+    Location at = loc();
     if(peek() == T_BREAK){
       consume(T_BREAK);
       consume(';');
-      return make_shared<BreakASTNode>();
+      return ast.add(NODE_BREAK, 0, at);
     } else{
       consume(T_CONTINUE);
       consume(';');
-      return make_shared<ContinueASTNode>();
+      return ast.add(NODE_CONTINUE, 0, at);
     }
   } else if(peek() == T_ID){
     consume(T_ID);
@@ -132,7 +170,8 @@ shared_ptr<ASTNode> Parser::statement(){
   throw runtime_error("parsing recursion error");
 }
 
-shared_ptr<WhileASTNode> Parser::loop(){
+NodeId Parser::loop(){
+  Location at = loc();
   consume(T_WHILE);
   consume('(');
   auto ex = expr();
@@ -140,10 +179,11 @@ shared_ptr<WhileASTNode> Parser::loop(){
   consume('{');
   auto code = block();
   consume('}');
-  return make_shared<WhileASTNode>(ex, code);
+  return ast.add(NODE_WHILE, 0, at, {ex, code});
 }
 
-shared_ptr<IfASTNode> Parser::conditional(){
+NodeId Parser::conditional(){
+  Location at = loc();
   consume(T_IF);
   consume('(');
   auto ex = expr();
@@ -157,93 +197,109 @@ shared_ptr<IfASTNode> Parser::conditional(){
     consume('{');
     auto code2 = block();
     consume('}');
-    return make_shared<IfASTNode>(ex, code, code2);
+    return ast.add(NODE_IF, 0, at, {ex, code, code2});
   } else {
-    return make_shared<IfASTNode>(ex, code);
+    return ast.add(NODE_IF, 0, at, {ex, code});
   }
 }
 
-shared_ptr<ReturnASTNode> Parser::returns(){
+NodeId Parser::returns(){
+  Location at = loc();
   consume(T_RETURN);
   if(peek() != ';')
-    return make_shared<ReturnASTNode>(expr());
+    return ast.add(NODE_RETURN, 0, at, {expr()});
   else
-    return make_shared<ReturnASTNode>();
+    return ast.add(NODE_RETURN, 0, at);
 }
 
-shared_ptr<AssignASTNode> Parser::assign(){
+NodeId Parser::assign(){
+  Location at = loc();
   expect(T_ID);
-  auto id = consume_node<IdASTNode>();
+  auto id = consume_id();
   consume('=');
-  return make_shared<AssignASTNode>(id, expr());
+  return ast.add(NODE_ASSIGN, 0, at, {id, expr()});
 }
 
-shared_ptr<ASTNode> Parser::expr(){
-  auto res = expr0();
-  while(peek() == T_OR){
-    auto op = consume_node<ASTNode>();
-    res = make_shared<BinASTNode>(res, expr0(), op);
+// binding power of a binary operator token, 0 if it is not one
+int Parser::binary_precedence(int x){
+  switch(x){
+  case T_OR: return 1;
+  case T_AND: return 2;
+  case T_EQ: case T_NEQ: return 3;
+  case '<': case '>': case T_LEQ: case T_GEQ: return 4;
+  case '+': case '-': return 5;
+  case '*': case '/': return 6;
+  default: return 0;
   }
-  return res;
 }
 
-shared_ptr<ASTNode> Parser::expr0(){
-  auto res = expr1();
-  while(peek() == T_AND){
-    auto op = consume_node<ASTNode>();
-    res = make_shared<BinASTNode>(res, expr1(), op);
-  }
-  return res;
-}
+// folds the operator on top of the stack with its operands
+void Parser::reduce(){
+  PendingOperator top = operators.back();
+  operators.pop_back();
 
-shared_ptr<ASTNode> Parser::expr1(){
-  auto res = expr2();
-  while(peek() == T_EQ || peek() == T_NEQ){
-    auto op = consume_node<ASTNode>();
-    res = make_shared<BinASTNode>(res, expr2(), op);
+  NodeId right = operands.back();
+  if(top.prec == UNARY_PREC){
+    operands.back() = ast.add(NODE_UN, top.op, top.loc, {right});
+  } else {
+    operands.pop_back();
+    operands.back() = ast.add(NODE_BIN, top.op, top.loc,
+                              {operands.back(), right});
   }
-  return res;
 }
 
-shared_ptr<ASTNode> Parser::expr2(){
-  auto res = expr3();
-  while(peek() == '<' || peek() == '>'
-    || peek() == T_LEQ || peek() == T_GEQ){
-      auto op = consume_node<ASTNode>();
-      res = make_shared<BinASTNode>(res, expr3(), op);
-  }
-  return res;
-}
+// precedence climbing over explicit stacks: parentheses and prefix
+// operators nest on the heap, only function calls recurse
+NodeId Parser::expr(){
+  size_t base = operators.size();
+  int open = 0;
+
+  while(true){
+    while(peek() == '-' || peek() == '!' || peek() == '('){
+      if(peek() == '('){
+        operators.push_back({OP_INVALID, PAREN_PREC, loc()});
+        consume('(');
+        open++;
+      } else {
+        Location at = loc();
+        operators.push_back({consume_operator(), UNARY_PREC, at});
+      }
+    }
+    operands.push_back(expr_primary());
+
+    int prec;
+    while(!(prec = binary_precedence(peek())) && peek() == ')' && open){
+      while(operators.back().prec != PAREN_PREC)
+        reduce();
+      operators.pop_back();
+      consume(')');
+      open--;
+    }
 
-shared_ptr<ASTNode> Parser::expr3(){
-  auto res = expr4();
-  while(peek() == '+' || peek() == '-'){
-    auto op = consume_node<ASTNode>();
-    res = make_shared<BinASTNode>(res, expr4(), op);
-  }
-  return res;
-}
+    if(!prec)
+      break;
 
-shared_ptr<ASTNode> Parser::expr4(){
-  auto res = expr5();
-  while(peek() == '*' || peek() == '/'){
-    auto op = consume_node<ASTNode>();
-    res = make_shared<BinASTNode>(res, expr5(), op);
+    while(operators.size() > base && operators.back().prec >= prec)
+      reduce();
+    Location at = loc();
+    operators.push_back({consume_operator(), prec, at});
   }
+
+  if(open)
+    consume(')');
+
+  while(operators.size() > base)
+    reduce();
+
+  NodeId res = operands.back();
+  operands.pop_back();
   return res;
 }
 
-shared_ptr<ASTNode> Parser::expr5(){
-  if(peek() == '-' || peek() == '!'){
-    auto op = consume_node<ASTNode>();
-    return make_shared<UnASTNode>(expr5(), op);
-  } else if(peek() == '('){
-    consume('(');
-    auto res = expr();
-    consume(')');
-    return res;
-  } else if(peek() == T_DEC){
-    return consume_node<DecASTNode>();
+NodeId Parser::expr_primary(){
+  if(peek() == T_DEC){
+    Token t = consume_token();
+    return ast.add(NODE_DEC, atoi(t.lexeme().c_str()), t.location);
   } else if(peek() == T_ID){
     return expr_name();
   } else unexpected();
@@ -251,7 +307,7 @@ shared_ptr<ASTNode> Parser::expr5(){
   throw runtime_error("parsing recursion error");
 }
 
-shared_ptr<ASTNode> Parser::expr_name(){
+NodeId Parser::expr_name(){
   consume(T_ID);
   if(peek() == '('){
     unconsume();
@@ -262,30 +318,29 @@ shared_ptr<ASTNode> Parser::expr_name(){
   }
 }
 
-shared_ptr<IdASTNode> Parser::expr_id(){
-  return consume_node<IdASTNode>();
+NodeId Parser::expr_id(){
+  return consume_id();
 }
 
-shared_ptr<CallASTNode> Parser::funccall(){
+NodeId Parser::funccall(){
+  Location at = loc();
   expect(T_ID);
-  auto id = consume_node<IdASTNode>();
-  auto ar = make_shared<ArgsASTNode>();
+  auto id = consume_id();
 
   consume('(');
-  if(peek() != ')'){
-    ar = args();
-  }
+  auto ar = peek() != ')' ? args() : ast.add(NODE_ARGS, 0, loc());
   consume(')');
 
-  return make_shared<CallASTNode>(id, ar);
+  return ast.add(NODE_CALL, 0, at, {id, ar});
 }
 
-shared_ptr<ArgsASTNode> Parser::args(){
-  auto res = make_shared<ArgsASTNode>();
-  res->append(expr());
+NodeId Parser::args(){
+  Location at = loc();
+  std::vector<NodeId> items;
+  items.push_back(expr());
   while(peek() == ','){
     consume();
-    res->append(expr());
+    items.push_back(expr());
   }
-  return res;
+  return ast.add(NODE_ARGS, 0, at, items);
 }
@@ -5,8 +5,9 @@
 #include <string>
 #include <cstdarg>
 #include <cassert>
-#include "lexer/token.hpp"
+#include "lexer/token_stream.hpp"
 #include "ast.hpp"
+#include "common/errors.hpp"
 
 #define T_ID 258
 #define T_DEC 259
@@ -33,10 +34,24 @@ namespace Parsing{
   extern char buf[BUF_SZ];
 }
 
+const int PAREN_PREC = 0;
+const int UNARY_PREC = 7;
+
 struct Parser{
-  std::vector<Token> tok;
+  TokenStream & tok;
+  AST & ast;
+  ErrorLog * errors;
   int ptr;
 
+  // expression stacks, shared by nested expr() calls
+  struct PendingOperator{
+    Operator op;
+    int prec;
+    Location loc;
+  };
+  std::vector<NodeId> operands;
+  std::vector<PendingOperator> operators;
+
   void define_types(){
     #define TOKEN(x) Parsing::types[x] = std::string(#x);
 
@@ -97,52 +112,79 @@ struct Parser{
   * END OF HELPERS
   */
 
-  Parser(const std::vector<Token> & tok) : tok(tok) { define_types(); ptr = 0; }
+  Parser(TokenStream & tok, AST & ast, ErrorLog * errors = 0)
+    : tok(tok), ast(ast), errors(errors) {
+    define_types(); ptr = 0;
+  }
 
   int token_val(const Token & tok) const {
-    return !tok.type ? tok.lexeme[0] : tok.type;
+    return !tok.type ? tok.text[0] : tok.type;
+  }
+
+  std::string lex(const Token & tok) const {
+    return tok.type == 0 ? "" : tok.lexeme();
   }
 
-  const char * lex(const Token & tok) const {
-    return tok.type == 0 ? "" : tok.lexeme.c_str();
+  // the lookahead token, or 0 at the end of the input
+  const Token * cur() {
+    return tok.get(ptr);
   }
 
-  std::pair<int, int> loc() const {
-    if(ptr >= (int)tok.size())
-      return tok.empty() ? std::make_pair(0, 0) : tok[ptr-1].location;
-    return tok[ptr].location;
+  std::pair<int, int> loc() {
+    if(!cur())
+      return ptr == 0 ? std::make_pair(0, 0) : tok.get(ptr-1)->location;
+    return cur()->location;
   }
 
-  int peek() const {
-    return ptr < (int)tok.size() ? token_val(tok[ptr]) : EOF;
+  int peek() {
+    return cur() ? token_val(*cur()) : EOF;
   }
 
   int consume() {
     if(peek() == EOF)
       return EOF;
-    return token_val(tok[ptr++]);
+    return token_val(*tok.get(ptr++));
   }
 
   Token consume_token(){
     assert(peek() != EOF);
-    return tok[ptr++];
+    return *tok.get(ptr++);
+  }
+
+  NodeId consume_id(){
+    Token t = consume_token();
+    return ast.add(NODE_ID, t.symbol, t.location);
   }
 
-  template<typename T>
-  shared_ptr<T> consume_node(){
-    return make_shared<T>(consume_token().lexeme);
+  Operator consume_operator(){
+    switch(consume()){
+    case '+': return OP_ADD;
+    case '-': return OP_SUB;
+    case '*': return OP_MUL;
+    case '/': return OP_DIV;
+    case '<': return OP_LT;
+    case '>': return OP_GT;
+    case '!': return OP_NOT;
+    case T_EQ: return OP_EQ;
+    case T_NEQ: return OP_NEQ;
+    case T_LEQ: return OP_LEQ;
+    case T_GEQ: return OP_GEQ;
+    case T_AND: return OP_AND;
+    case T_OR: return OP_OR;
+    default: return OP_INVALID;
+    }
   }
 
   void expect(int x){
     if(peek() != x)
       throw syntax_error(loc(),
         "expected %s, found %s %s", get_type(x).c_str(),
-        get_type(peek()).c_str(), ptr < (int)tok.size() ? lex(tok[ptr]) : "");
+        get_type(peek()).c_str(), cur() ? lex(*cur()).c_str() : "");
   }
 
   int consume(int x){
     expect(x);
-    return token_val(tok[ptr++]);
+    return token_val(*tok.get(ptr++));
   }
 
   void unconsume(){
@@ -153,37 +195,71 @@ struct Parser{
   void unexpected(){
     throw syntax_error(loc(),
       "unexpected %s %s",
-      get_type(peek()).c_str(), ptr < (int)tok.size() ? lex(tok[ptr]) : "");
+      get_type(peek()).c_str(), cur() ? lex(*cur()).c_str() : "");
+  }
+
+  bool recovering() const {
+    return errors && errors->recovering();
+  }
+
+  // reports e so the caller can skip ahead; without recovery e
+  // propagates instead, and once the error limit is reached parsing
+  // unwinds with ErrorLimit, which no recovery point catches
+  void recover(const std::runtime_error & e){
+    if(!recovering())
+      throw e;
+    if(!errors->report(e.what()))
+      throw ErrorLimit();
+    operands.clear();
+    operators.clear();
+  }
+
+  // panic mode: skips the rest of a statement, through its ';' or a
+  // balanced {...} (with any else part), stopping early before an
+  // unmatched '}' or a def
+  void synchronize(){
+    int depth = 0;
+    while(peek() != EOF && peek() != T_DEF){
+      int x = peek();
+      if(x == '}' && !depth)
+        return;
+
+      consume();
+      if(x == '{')
+        depth++;
+      else if(x == '}' && !--depth && peek() != T_ELSE)
+        return;
+      else if(x == ';' && !depth)
+        return;
+    }
   }
 
   /*
     Parsing procedures
   */
-  shared_ptr<ProgASTNode> program();
-  shared_ptr<TypeASTNode> type();
-  shared_ptr<DecvarASTNode> decvar();
-  shared_ptr<DecfuncASTNode> decfunc();
-  shared_ptr<ParamsASTNode> params();
-  shared_ptr<VarASTNode> params1();
-  shared_ptr<BlockASTNode> block();
-  shared_ptr<ASTNode> statement();
-  shared_ptr<ReturnASTNode> returns();
-  shared_ptr<AssignASTNode> assign();
-
-  shared_ptr<WhileASTNode> loop();
-  shared_ptr<IfASTNode> conditional();
+  NodeId program();
+  NodeId type();
+  NodeId decvar();
+  NodeId decfunc();
+  NodeId params();
+  NodeId params1();
+  NodeId block();
+  NodeId statement();
+  NodeId returns();
+  NodeId assign();
+
+  NodeId loop();
+  NodeId conditional();
 
   /* Expressions */
-  shared_ptr<ASTNode> expr();
-  shared_ptr<ASTNode> expr0();
-  shared_ptr<ASTNode> expr1();
-  shared_ptr<ASTNode> expr2();
-  shared_ptr<ASTNode> expr3();
-  shared_ptr<ASTNode> expr4();
-  shared_ptr<ASTNode> expr5();
-  shared_ptr<ASTNode> expr_name();
-  shared_ptr<IdASTNode> expr_id();
-
-  shared_ptr<CallASTNode> funccall();
-  shared_ptr<ArgsASTNode> args();
+  NodeId expr();
+  NodeId expr_primary();
+  NodeId expr_name();
+  NodeId expr_id();
+
+  NodeId funccall();
+  NodeId args();
+
+  int binary_precedence(int x);
+  void reduce();
 };
@@ -7,6 +7,7 @@
 #include <memory>
 #include <iostream>
 #include <cassert>
+#include "lexer/symbols.hpp"
 
 using namespace std;
 
@@ -51,84 +52,97 @@ struct ScopeInt : public ScopeValue {
 
 struct Scope{
   bool inside_int;
-  void * inside_loop;
+  int inside_loop; // loop index, 0 outside loops
 
-  map<string, shared_ptr<ScopeInt>> table_int;
-  map<string, shared_ptr<ScopeFunc>> table_func;
+  // keyed by symbol id
+  map<int, shared_ptr<ScopeInt>> table_int;
+  map<int, shared_ptr<ScopeFunc>> table_func;
   Scope(){
     inside_int = false;
     inside_loop = 0;
   }
 
-  bool check_int(string s) { return table_int.count(s); }
-  bool check_func(string s) { return table_func.count(s); }
-  shared_ptr<ScopeInt> & get_int(string s) { return table_int[s]; }
-  shared_ptr<ScopeFunc> & get_func(string s) { return table_func[s]; }
+  bool check_int(int s) { return table_int.count(s); }
+  bool check_func(int s) { return table_func.count(s); }
+  shared_ptr<ScopeInt> & get_int(int s) { return table_int[s]; }
+  shared_ptr<ScopeFunc> & get_func(int s) { return table_func[s]; }
 };
 
 struct ScopeStack{
   int loop_cnt = 0, if_cnt = 0;
   vector<Scope> st;
+  SymbolTable & symbols;
 
-  shared_ptr<ScopeInt> & _declare_int(string var){
+  ScopeStack(SymbolTable & symbols) : symbols(symbols){}
+
+  // symbol id of a name the compiler itself refers to
+  int symbol(const string & name){
+    return symbols.intern(name);
+  }
+
+  const string & name(int var) const {
+    return symbols.name(var);
+  }
+
+  shared_ptr<ScopeInt> & _declare_int(int var){
     if(st.back().check_int(var))
-      throw runtime_error("variable " + var + " was declared before");
+      throw runtime_error("variable " + name(var) + " was declared before");
 
     return st.back().get_int(var);
   }
-  shared_ptr<ScopeFunc> & _declare_func(string var){
+  shared_ptr<ScopeFunc> & _declare_func(int var){
     if(st.back().check_func(var))
-      throw runtime_error("function " + var + " was declared before");
+      throw runtime_error("function " + name(var) + " was declared before");
 
     return st.back().get_func(var);
   }
-  ScopeFunc & declare_func(string var, bool returns_int = false, int no_params = 0, int no_var = 0){
+  ScopeFunc & declare_func(int var, bool returns_int = false, int no_params = 0, int no_var = 0){
     return *(this->_declare_func(var) = make_shared<ScopeFunc>(returns_int, no_params, no_var));
   }
 
-  ScopeInt & declare_int(string var, bool is_global = false){
+  ScopeInt & declare_int(int var, bool is_global = false){
     return *(this->_declare_int(var) = make_shared<ScopeInt>(is_global));
   }
 
-  shared_ptr<ScopeInt> _get_int(string var){
+  shared_ptr<ScopeInt> _get_int(int var){
     for(int i = (int)st.size()-1; i >= 0; i--){
       if(st[i].check_int(var))
         return st[i].get_int(var);
     }
 
-    throw runtime_error("variable " + var + " not declared in this scope");
+    throw runtime_error("variable " + name(var) + " not declared in this scope");
   }
 
-  shared_ptr<ScopeFunc> _get_func(string var){
+  shared_ptr<ScopeFunc> _get_func(int var){
     for(int i = (int)st.size()-1; i >= 0; i--){
       if(st[i].check_func(var))
         return st[i].get_func(var);
     }
 
-    throw runtime_error("function " + var + " not declared in this scope");
+    throw runtime_error("function " + name(var) + " not declared in this scope");
   }
-  ScopeFunc & get_func(string var){
+  ScopeFunc & get_func(int var){
     shared_ptr<ScopeFunc> res = 0;
     try{
       res = this->_get_func(var);
     } catch(std::exception & e){
-      throw runtime_error("name " + var + " not declared in this scope");
+      throw runtime_error("name " + name(var) + " not declared in this scope");
     }
 
     if(res == 0)
-      throw runtime_error("name " + var + " was declared before but is not a function");
+      throw runtime_error("name " + name(var) + " was declared before but is not a function");
     return *res;
   }
 
-  ScopeInt & get_int(string var){
+  ScopeInt & get_int(int var){
     shared_ptr<ScopeInt> res = 0;
     try{
       res = this->_get_int(var);
     } catch(std::exception & e){
-      throw runtime_error("name " + var + " not declared in this scope");
+      throw runtime_error("name " + name(var) + " not declared in this scope");
     }
     if(res == 0)
-      throw runtime_error("name " + var + " was declared before but is not an int");
+      throw runtime_error("name " + name(var) + " was declared before but is not an int");
     return *res;
 
   }
@@ -157,10 +171,10 @@ struct ScopeStack{
     return if_cnt;
   }
 
-  int push_loop(void * no){
+  int push_loop(){
     push();
     loop_cnt++;
-    st.back().inside_loop = no;
+    st.back().inside_loop = loop_cnt;
     return loop_cnt;
   }
 
@@ -168,7 +182,7 @@ struct ScopeStack{
     st.pop_back();
   }
 
-  void * last_loop() const {
+  int last_loop() const {
     for(int i = (int)st.size()-1; i >= 0; i--)
       if(st[i].inside_loop)
         return st[i].inside_loop;
@@ -191,7 +205,7 @@ struct ScopeStack{
     return false;
   }
 
-  void * loop_block() const {
+  int loop_block() const {
     return st.back().inside_loop;
   }
 
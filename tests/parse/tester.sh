@@ -0,0 +1,29 @@
+#!/bin/bash
+# every syntax error up to the limit must be reported exactly once
+for file in recovery/*.def; do
+    for limit in 3 100; do
+        echo `basename $file` -e $limit
+        ./$1 $file -p 1 -n -e $limit 2> out_`basename $file`.$limit.txt
+        diff out_`basename $file`.$limit.txt recovery/ans_`basename $file`.$limit.txt
+        echo
+    done
+done
+
+# expressions nest on the heap in every phase, however deep
+repeat() {
+    yes -- "$1" | head -n 200000 | tr -d '\n'
+}
+deep() {
+    echo "def int main() { int a; a = $(repeat "$1")a$(repeat "$2"); return a; }"
+}
+for chain in '- ' '(' 'a + '; do
+    suffix=''
+    [ "$chain" = '(' ] && suffix=')'
+    deep "$chain" "$suffix" > deep.def
+    echo deep "'$chain'"
+    for p in 1 2 3; do
+        ./$1 deep.def -p $p > /dev/null || echo "-p $p failed"
+    done
+    echo
+done
+rm -f deep.def